@@ -0,0 +1,576 @@
+#include "BatchRenderer.h"
+
+#include "../../Source/PluginProcessor.h"
+
+double BatchRenderer::Result::getRealtimeMultiple() const
+{
+    return renderSeconds > 0.0 ? audioSeconds / renderSeconds : 0.0;
+}
+
+BatchRenderer::MemoryBudget::MemoryBudget(size_t numBytes)
+  : m_numBytes(numBytes)
+  , m_numAvailable(numBytes)
+{
+}
+
+// returns what was actually taken, which is what has to be given back
+size_t BatchRenderer::MemoryBudget::acquire(size_t numBytes)
+{
+    numBytes = juce::jmin(numBytes, m_numBytes);
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_released.wait(lock, [this, numBytes] { return m_numAvailable >= numBytes; });
+    m_numAvailable -= numBytes;
+
+    return numBytes;
+}
+
+void BatchRenderer::MemoryBudget::release(size_t numBytes)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        m_numAvailable += numBytes;
+    }
+
+    m_released.notify_all();
+}
+
+BatchRenderer::BatchRenderer(Settings settings)
+  : m_settings(std::move(settings))
+  , m_memoryBudget(m_settings.memoryBudgetBytes)
+{
+    m_formatManager.registerBasicFormats();
+}
+
+// a file being rendered, shared by its segments; whichever segment finishes last stitches the file together
+struct BatchRenderer::FileJob
+{
+    Result result;
+    std::function<void(const Result&)> onFinished;
+
+    int numChannels = 0;
+    double sampleRate = 0.0;
+    juce::int64 numSamples = 0;
+
+    // how the output is written, once the first segment opens it
+    juce::AudioFormat* format = nullptr;
+    int bitsPerSample = 0;
+    juce::StringPairArray metadataValues;
+    bool isVerified = false;
+
+    // segment i covers the file from segmentStarts[i] up to segmentStarts[i + 1]
+    std::vector<juce::int64> segmentStarts;
+
+    // the first segment writes straight to the output and the others to temporary files beside it, appended in order
+    // once every segment is done; a verified file has its first segment in a temporary file as well, so that all of
+    // its output is still there as floats to compare with a serial render. each segment opens its own when it starts
+    // writing, the first one the output too, and segmentFiles[i] belongs to segment i
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    std::vector<std::unique_ptr<juce::TemporaryFile>> segmentFiles;
+
+    std::atomic<int> numRemaining = 0;
+    std::atomic<bool> hasFailed = false;
+    std::mutex errorLock;
+    double startSeconds = 0.0;
+
+    // keeps the first error; the other segments stop at their next block
+    void fail(const juce::String& error)
+    {
+        const std::lock_guard<std::mutex> lock(errorLock);
+
+        if (result.error.isEmpty()) {
+            result.error = error;
+        }
+
+        hasFailed = true;
+    }
+};
+
+// segments are kept as raw interleaved floats; they are only ever read back by this process
+static bool writeInterleaved(juce::OutputStream& stream, const juce::AudioBuffer<float>& buffer, int startSample, int numSamples, std::vector<float>& interleaved)
+{
+    const int numChannels = buffer.getNumChannels();
+    interleaved.resize(static_cast<size_t>(numChannels * numSamples));
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        const float* samples = buffer.getReadPointer(channel, startSample);
+
+        for (int i = 0; i < numSamples; ++i) {
+            interleaved[static_cast<size_t>(i * numChannels + channel)] = samples[i];
+        }
+    }
+
+    return stream.write(interleaved.data(), interleaved.size() * sizeof(float));
+}
+
+std::vector<BatchRenderer::Result> BatchRenderer::render(const juce::Array<juce::File>& files, std::function<void(const Result&)> onResult)
+{
+    std::vector<Result> results(static_cast<size_t>(files.size()));
+
+    if (files.isEmpty()) {
+        return results;
+    }
+
+    // declared ahead of the pool so that they outlive its threads
+    std::vector<std::unique_ptr<FileJob>> jobs;
+    juce::WaitableEvent isFinished;
+    std::atomic<int> numRemaining = files.size();
+
+    const int numThreads = juce::jmax(1, m_settings.numThreads);
+    const int maxNumSegments = m_settings.numSegments > 0 ? m_settings.numSegments : juce::jmax(1, numThreads / files.size());
+    juce::ThreadPool threadPool(numThreads);
+
+    // every segment of every file is a job of its own, so that a few long files keep the pool as busy as many short ones
+    for (int i = 0; i < files.size(); ++i) {
+        const auto& input = files.getReference(i);
+        auto job = this->planFile(input, this->getOutputFile(input), maxNumSegments);
+
+        job->onFinished = [&results, &onResult, &numRemaining, &isFinished, i](const Result& result) {
+            results[static_cast<size_t>(i)] = result;
+
+            if (onResult) {
+                onResult(result);
+            }
+
+            if (--numRemaining == 0) {
+                isFinished.signal();
+            }
+        };
+
+        if (job->result.error.isNotEmpty()) {
+            job->onFinished(job->result);
+            continue;
+        }
+
+        for (int segment = 0; segment < job->result.numSegments; ++segment) {
+            threadPool.addJob([this, job = job.get(), segment] { this->runSegment(*job, segment); });
+        }
+
+        jobs.push_back(std::move(job));
+    }
+
+    isFinished.wait();
+    return results;
+}
+
+BatchRenderer::Result BatchRenderer::renderFile(const juce::File& input)
+{
+    auto job = this->planFile(input, this->getOutputFile(input), 1);
+
+    if (job->result.error.isEmpty()) {
+        this->runSegment(*job, 0);
+    }
+
+    return job->result;
+}
+
+// reads the file's header, picks the output format and decides where the segments fall; nothing is opened for writing
+// until a segment runs, so a long batch holds no more outputs than it renders at once. any error is left in the job's
+// result
+std::unique_ptr<BatchRenderer::FileJob> BatchRenderer::planFile(const juce::File& input, const juce::File& output, int maxNumSegments)
+{
+    auto job = std::make_unique<FileJob>();
+    auto& result = job->result;
+    result.input = input;
+    result.output = output;
+
+    std::unique_ptr<juce::AudioFormatReader> reader(m_formatManager.createReaderFor(input));
+
+    if (reader == nullptr) {
+        result.error = "not a readable WAV or FLAC file";
+        return job;
+    }
+
+    const int numChannels = static_cast<int>(reader->numChannels);
+
+    if (numChannels < 1 || numChannels > MAX_CHANNELS) {
+        result.error = "unsupported channel count " + juce::String(numChannels);
+        return job;
+    }
+
+    auto* format = m_formatManager.findFormatForFileExtension(output.getFileExtension());
+
+    if (format == nullptr) {
+        result.error = "no writer for " + output.getFileExtension();
+        return job;
+    }
+
+    job->numChannels = numChannels;
+    job->sampleRate = reader->sampleRate;
+    job->numSamples = reader->lengthInSamples;
+
+    // segments start on multiples of the largest FFT size, and so of every hop, which puts each segment's frames
+    // exactly where a serial run has them; shorter than a few dozen windows, a segment spends too much of its time
+    // warming up to be worth splitting off
+    const juce::int64 maxFFTSize = juce::int64(1) << MAX_FFT_ORDER;
+    const juce::int64 minSegmentLength = 32 * maxFFTSize;
+    const int numSegments = static_cast<int>(juce::jlimit<juce::int64>(1, juce::jmax(1, maxNumSegments), job->numSamples / minSegmentLength));
+
+    for (int segment = 0; segment < numSegments; ++segment) {
+        job->segmentStarts.push_back(job->numSamples * segment / numSegments / maxFFTSize * maxFFTSize);
+    }
+
+    job->segmentStarts.push_back(job->numSamples);
+    result.numSegments = numSegments;
+
+    // the source's bit depth where the output format has it, otherwise the deepest it offers
+    const auto bitDepths = format->getPossibleBitDepths();
+
+    job->format = format;
+    job->bitsPerSample = bitDepths.contains(static_cast<int>(reader->bitsPerSample)) ? static_cast<int>(reader->bitsPerSample) : bitDepths.getLast();
+    job->metadataValues = reader->metadataValues;
+    job->isVerified = m_settings.verify && numSegments > 1;
+    job->segmentFiles.resize(static_cast<size_t>(numSegments));
+
+    job->numRemaining = numSegments;
+    job->startSeconds = juce::Time::getMillisecondCounterHiRes() / 1000.0;
+
+    return job;
+}
+
+void BatchRenderer::runSegment(FileJob& job, int segment)
+{
+    if (const auto error = this->renderSegment(job, segment); error.isNotEmpty()) {
+        job.fail(error);
+    }
+
+    if (--job.numRemaining == 0) {
+        this->finishFile(job);
+    }
+}
+
+// returns an error message, or nothing once the segment is written
+juce::String BatchRenderer::renderSegment(FileJob& job, int segment)
+{
+    if (job.hasFailed) {
+        return {};
+    }
+
+    std::unique_ptr<juce::FileOutputStream> segmentStream;
+    std::vector<float> interleaved;
+    bool isOpen = false;
+
+    const auto write = [this, &job, segment, &segmentStream, &interleaved, &isOpen](
+                           const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) -> juce::String {
+        // the first block opens what the segment writes to, under the memory budget that renderRange holds
+        if (!isOpen) {
+            if (const auto error = this->openSegment(job, segment, segmentStream); error.isNotEmpty()) {
+                return error;
+            }
+
+            isOpen = true;
+        }
+
+        const bool isWritten = segmentStream == nullptr ? job.writer->writeFromAudioSampleBuffer(buffer, startSample, numSamples)
+                                                        : writeInterleaved(*segmentStream, buffer, startSample, numSamples, interleaved);
+
+        return isWritten ? juce::String() : juce::String("write failed");
+    };
+
+    const juce::int64 segmentStart = job.segmentStarts[static_cast<size_t>(segment)];
+    return this->renderRange(job, segmentStart, job.segmentStarts[static_cast<size_t>(segment + 1)] - segmentStart, write);
+}
+
+// the first segment creates the output, which every segment ends up in; a segment kept apart until the end also
+// creates its temporary file and opens it as stream. returns an error message, or nothing once both are open
+juce::String BatchRenderer::openSegment(FileJob& job, int segment, std::unique_ptr<juce::FileOutputStream>& stream)
+{
+    if (segment == 0) {
+        const auto& output = job.result.output;
+        output.deleteFile();
+        std::unique_ptr<juce::FileOutputStream> outputStream(output.createOutputStream());
+
+        if (outputStream == nullptr || outputStream->failedToOpen()) {
+            return "cannot write " + output.getFullPathName();
+        }
+
+        job.writer.reset(job.format->createWriterFor(
+            outputStream.get(), job.sampleRate, static_cast<unsigned>(job.numChannels), job.bitsPerSample, job.metadataValues, 0));
+
+        if (job.writer == nullptr) {
+            return "cannot write " + juce::String(job.numChannels) + " channels at " + juce::String(job.bitsPerSample) + " bits";
+        }
+
+        // the writer owns the stream from here on
+        outputStream.release();
+    }
+
+    if (segment == 0 && !job.isVerified) {
+        return {};
+    }
+
+    auto& segmentFile = job.segmentFiles[static_cast<size_t>(segment)];
+    segmentFile = std::make_unique<juce::TemporaryFile>(job.result.output);
+    stream = segmentFile->getFile().createOutputStream();
+
+    if (stream == nullptr || stream->failedToOpen()) {
+        return "cannot write " + segmentFile->getFile().getFullPathName();
+    }
+
+    return {};
+}
+
+// renders length samples of the file from start on, handing them to write a block at a time; returns an error message,
+// or nothing once they are all written
+juce::String BatchRenderer::renderRange(const FileJob& job, juce::int64 start, juce::int64 length, const BlockWriter& write)
+{
+    // each range reads through a reader of its own, a block at a time
+    std::unique_ptr<juce::AudioFormatReader> reader(m_formatManager.createReaderFor(job.result.input));
+
+    if (reader == nullptr) {
+        return "cannot reopen " + job.result.input.getFullPathName();
+    }
+
+    // everything below is held until the range is done
+    const size_t numBudgetBytes = m_memoryBudget.acquire(this->estimateMemory(job.numChannels));
+    const juce::ScopeGuard releaseBudget{ [this, numBudgetBytes] { m_memoryBudget.release(numBudgetBytes); } };
+
+    PluginProcessor processor;
+
+    if (const auto error = this->applySettings(processor); error.isNotEmpty()) {
+        return error;
+    }
+
+    const int blockSize = m_settings.blockSize;
+
+    // the ranges already render side by side, one per thread, so only a single-threaded render hands its hops to the
+    // pool; otherwise every thread would also wait on pool workers competing with the other threads for the same cores
+    processor.setUsesWorkerPool(m_settings.numThreads <= 1);
+    processor.setNonRealtime(true);
+    processor.setPlayConfigDetails(job.numChannels, job.numChannels, job.sampleRate, blockSize);
+    processor.prepareToPlay(job.sampleRate, blockSize);
+
+    // the engine only starts transforming once its input ring has filled, so rendering starts that far ahead of the
+    // range: in silence before the file, or in the audio before the range, which leaves the engine exactly as a serial
+    // run would have it. the latency is cut from the output and flushed with whatever follows the range
+    const juce::int64 numLatencySamples = processor.getLatencySamples();
+    const juce::int64 numPreRollSamples = 2 * numLatencySamples;
+
+    juce::AudioBuffer<float> buffer(job.numChannels, blockSize);
+    juce::MidiBuffer midiMessages;
+
+    // the file position of the block's first sample, negative during the pre-roll of a range at the start of the file
+    juce::int64 blockStart = start - numPreRollSamples;
+    juce::int64 numToDiscard = numPreRollSamples + numLatencySamples;
+    juce::int64 numWritten = 0;
+
+    while (numWritten < length) {
+        if (job.hasFailed) {
+            return {};
+        }
+
+        buffer.clear();
+
+        // outside the file the block stays silent, which also flushes the latency at the end
+        const juce::int64 readStart = juce::jmax<juce::int64>(blockStart, 0);
+        const juce::int64 readEnd = juce::jmin<juce::int64>(blockStart + blockSize, job.numSamples);
+
+        if (readEnd > readStart) {
+            reader->read(&buffer, static_cast<int>(readStart - blockStart), static_cast<int>(readEnd - readStart), readStart, true, true);
+        }
+
+        processor.processBlock(buffer, midiMessages);
+        blockStart += blockSize;
+
+        const int numSkipped = static_cast<int>(juce::jmin<juce::int64>(numToDiscard, blockSize));
+        const int numToWrite = static_cast<int>(juce::jmin<juce::int64>(blockSize - numSkipped, length - numWritten));
+        numToDiscard -= numSkipped;
+
+        if (numToWrite > 0) {
+            if (const auto error = write(buffer, numSkipped, numToWrite); error.isNotEmpty()) {
+                return error;
+            }
+
+            numWritten += numToWrite;
+        }
+    }
+
+    processor.releaseResources();
+    return {};
+}
+
+// copies a finished segment from its temporary file onto the end of the output
+juce::String BatchRenderer::appendSegment(FileJob& job, int segment)
+{
+    const auto segmentFile = job.segmentFiles[static_cast<size_t>(segment)]->getFile();
+    juce::FileInputStream stream(segmentFile);
+
+    if (stream.failedToOpen()) {
+        return "cannot read back " + segmentFile.getFullPathName();
+    }
+
+    const int numChannels = job.numChannels;
+    const int chunkSize = 1 << 14;
+
+    juce::AudioBuffer<float> buffer(numChannels, chunkSize);
+    std::vector<float> interleaved(static_cast<size_t>(numChannels * chunkSize));
+
+    for (;;) {
+        const int numBytes = stream.read(interleaved.data(), static_cast<int>(interleaved.size() * sizeof(float)));
+        const int numFrames = numBytes / static_cast<int>(numChannels * sizeof(float));
+
+        if (numFrames == 0) {
+            return {};
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            float* samples = buffer.getWritePointer(channel);
+
+            for (int i = 0; i < numFrames; ++i) {
+                samples[i] = interleaved[static_cast<size_t>(i * numChannels + channel)];
+            }
+        }
+
+        if (!job.writer->writeFromAudioSampleBuffer(buffer, 0, numFrames)) {
+            return "write failed";
+        }
+    }
+}
+
+void BatchRenderer::finishFile(FileJob& job)
+{
+    auto& result = job.result;
+
+    for (int segment = 0; segment < result.numSegments && !job.hasFailed; ++segment) {
+        if (job.segmentFiles[static_cast<size_t>(segment)] == nullptr) {
+            continue;
+        }
+
+        if (const auto error = this->appendSegment(job, segment); error.isNotEmpty()) {
+            job.fail(error);
+        }
+    }
+
+    job.writer.reset();
+
+    if (result.error.isEmpty()) {
+        result.audioSeconds = static_cast<double>(job.numSamples) / job.sampleRate;
+        result.renderSeconds = juce::Time::getMillisecondCounterHiRes() / 1000.0 - job.startSeconds;
+
+        // a file rendered in one piece is its own serial render
+        if (m_settings.verify && result.numSegments > 1) {
+            result.error = this->verifyFile(job);
+            result.isVerified = result.error.isEmpty();
+        }
+    }
+
+    job.segmentFiles.clear();
+
+    if (job.onFinished) {
+        job.onFinished(result);
+    }
+}
+
+// renders the input again in one piece and compares it, a block at a time, with the segments' temporary files, which
+// hold the processor's floats as they were before the output quantised them; returns where the two first differ, or
+// nothing if every bit matches
+juce::String BatchRenderer::verifyFile(FileJob& job)
+{
+    const int numChannels = job.numChannels;
+    const int numSegments = job.result.numSegments;
+    const int frameSize = static_cast<int>(numChannels * sizeof(float));
+
+    // the segmented output, read back across the temporary files in order
+    std::unique_ptr<juce::FileInputStream> segmentStream;
+    int segment = -1;
+    juce::int64 position = 0;
+    std::vector<float> segmented;
+
+    const auto compare = [&](const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) -> juce::String {
+        segmented.resize(static_cast<size_t>(numChannels * numSamples));
+
+        for (int numRead = 0; numRead < numSamples;) {
+            if (segmentStream == nullptr) {
+                if (++segment == numSegments) {
+                    return "segmented render ends at sample " + juce::String(position + numRead) + ", before a serial render";
+                }
+
+                const auto segmentFile = job.segmentFiles[static_cast<size_t>(segment)]->getFile();
+                segmentStream = std::make_unique<juce::FileInputStream>(segmentFile);
+
+                if (segmentStream->failedToOpen()) {
+                    return "cannot read back " + segmentFile.getFullPathName();
+                }
+            }
+
+            const int numBytes = segmentStream->read(segmented.data() + numRead * numChannels, (numSamples - numRead) * frameSize);
+
+            if (numBytes <= 0) {
+                segmentStream.reset();
+            }
+
+            numRead += juce::jmax(0, numBytes) / frameSize;
+        }
+
+        // bit for bit, so that neither a signed zero nor a NaN passes for another value
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float* serial = buffer.getReadPointer(channel, startSample);
+
+            for (int i = 0; i < numSamples; ++i) {
+                if (std::memcmp(&serial[i], &segmented[static_cast<size_t>(i * numChannels + channel)], sizeof(float)) != 0) {
+                    return "segmented render differs from a serial render at sample " + juce::String(position + i) + " of channel "
+                           + juce::String(channel + 1);
+                }
+            }
+        }
+
+        position += numSamples;
+        return {};
+    };
+
+    if (const auto error = this->renderRange(job, 0, job.numSamples, compare); error.isNotEmpty()) {
+        return error;
+    }
+
+    if (segment < numSegments - 1 || (segmentStream != nullptr && !segmentStream->isExhausted())) {
+        return "segmented render runs on past a serial render's " + juce::String(job.numSamples) + " samples";
+    }
+
+    return {};
+}
+
+juce::File BatchRenderer::getOutputFile(const juce::File& input) const
+{
+    const auto directory = m_settings.outputDirectory == juce::File() ? input.getParentDirectory() : m_settings.outputDirectory;
+    return directory.getChildFile(input.getFileNameWithoutExtension() + m_settings.outputSuffix + input.getFileExtension());
+}
+
+// the engine at the largest FFT size (its rings, workspace and analysis frames come to under ten windows a channel),
+// the block, and a margin for the reader's and writer's own buffering; only ever an upper bound
+size_t BatchRenderer::estimateMemory(int numChannels) const
+{
+    const size_t maxFFTSize = size_t(1) << MAX_FFT_ORDER;
+    const size_t streamMargin = size_t(1) << 20;
+
+    return static_cast<size_t>(numChannels) * (10 * maxFFTSize + static_cast<size_t>(m_settings.blockSize)) * sizeof(float) + streamMargin;
+}
+
+// returns an error message, or nothing if every setting was applied
+juce::String BatchRenderer::applySettings(juce::AudioProcessor& processor) const
+{
+    if (m_settings.state != nullptr) {
+        juce::MemoryBlock state;
+        juce::AudioProcessor::copyXmlToBinary(*m_settings.state, state);
+        processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+    }
+
+    const auto& parameterIDs = m_settings.parameters.getAllKeys();
+
+    for (const auto& parameterID : parameterIDs) {
+        juce::AudioProcessorParameter* parameter = nullptr;
+
+        for (auto* candidate : processor.getParameters()) {
+            if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(candidate); withID != nullptr && withID->paramID == parameterID) {
+                parameter = candidate;
+            }
+        }
+
+        if (parameter == nullptr) {
+            return "unknown parameter " + parameterID;
+        }
+
+        parameter->setValueNotifyingHost(parameter->getValueForText(m_settings.parameters[parameterID]));
+    }
+
+    return {};
+}
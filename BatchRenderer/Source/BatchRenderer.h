@@ -0,0 +1,102 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <condition_variable>
+#include <mutex>
+
+// renders audio files through PluginProcessor with no host or editor; files are streamed a block at a time and run
+// concurrently on a thread pool, as many at once as the memory budget allows
+//
+// a long file is also split into segments rendered side by side: each segment's processor is primed on the audio
+// before it, and finishes on the audio after it, exactly as a serial run would have it, so the stitched output is
+// sample-identical to rendering the file in one piece
+class BatchRenderer
+{
+  public:
+    struct Settings
+    {
+        // a saved plugin state, applied before the individual parameters
+        std::unique_ptr<juce::XmlElement> state;
+        // parameter IDs and values as text, e.g. { "fftSize", "2048" } or { "overlap", "4x" }
+        juce::StringPairArray parameters;
+
+        // empty renders next to each input
+        juce::File outputDirectory;
+        juce::String outputSuffix = "-filtered";
+
+        // ranges rendered at once; with more than one, the processors do not also use the worker pool
+        int numThreads = juce::SystemStats::getNumCpus();
+        int blockSize = 512;
+        size_t memoryBudgetBytes = size_t(1024) << 20;
+
+        // segments per file; zero picks enough to keep every thread busy
+        int numSegments = 0;
+        // renders each segmented file again in one piece and compares the two bit for bit, as floats straight from the
+        // processor, before either is written at the output's bit depth
+        bool verify = false;
+    };
+
+    struct Result
+    {
+        juce::File input;
+        juce::File output;
+        double audioSeconds = 0.0;
+        double renderSeconds = 0.0;
+        int numSegments = 1;
+        // set once a segmented render has been found identical to a serial one; a mismatch is an error
+        bool isVerified = false;
+        juce::String error;
+
+        double getRealtimeMultiple() const;
+    };
+
+    explicit BatchRenderer(Settings settings);
+
+    // renders every file and returns one result per file, in the order given; onResult is called as each one finishes,
+    // from whichever thread rendered it
+    std::vector<Result> render(const juce::Array<juce::File>& files, std::function<void(const Result&)> onResult = {});
+
+    // renders a single file on the calling thread, in one piece
+    Result renderFile(const juce::File& input);
+
+  private:
+    struct FileJob;
+
+    // takes a rendered block's samples from startSample on; returns an error message, or nothing once they are taken
+    using BlockWriter = std::function<juce::String(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)>;
+
+    // hands out bytes to renders and makes them wait while the rest of the budget is in use; a render larger than the
+    // whole budget waits until it is the only one running
+    class MemoryBudget
+    {
+      public:
+        explicit MemoryBudget(size_t numBytes);
+
+        size_t acquire(size_t numBytes);
+        void release(size_t numBytes);
+
+      private:
+        const size_t m_numBytes;
+        size_t m_numAvailable;
+        std::mutex m_lock;
+        std::condition_variable m_released;
+    };
+
+    const Settings m_settings;
+    juce::AudioFormatManager m_formatManager;
+    MemoryBudget m_memoryBudget;
+
+    std::unique_ptr<FileJob> planFile(const juce::File& input, const juce::File& output, int maxNumSegments);
+    void runSegment(FileJob& job, int segment);
+    juce::String renderSegment(FileJob& job, int segment);
+    juce::String openSegment(FileJob& job, int segment, std::unique_ptr<juce::FileOutputStream>& stream);
+    juce::String renderRange(const FileJob& job, juce::int64 start, juce::int64 length, const BlockWriter& write);
+    juce::String appendSegment(FileJob& job, int segment);
+    void finishFile(FileJob& job);
+    juce::String verifyFile(FileJob& job);
+
+    juce::File getOutputFile(const juce::File& input) const;
+    size_t estimateMemory(int numChannels) const;
+    juce::String applySettings(juce::AudioProcessor& processor) const;
+};
@@ -0,0 +1,113 @@
+#include <JuceHeader.h>
+
+#include <iostream>
+
+#include "BatchRenderer.h"
+
+static void printUsage()
+{
+    std::cout << "usage: BatchRenderer [options] file...\n"
+                 "\n"
+                 "renders WAV or FLAC files through the filter, latency compensated\n"
+                 "\n"
+                 "  --output-dir <dir>      where rendered files go; next to each input by default\n"
+                 "  --suffix <text>         appended to each output name; -filtered by default\n"
+                 "  --state <file>          a saved plugin state as XML, applied before any parameter\n"
+                 "  --<parameter> <value>   a parameter by ID, as the plugin shows it: --bands 0.7 --fftSize 2048 --overlap 4x\n"
+                 "  --threads <n>           segments rendered at once; all cores by default\n"
+                 "  --segments <n>          pieces each long file is split into; enough to keep every thread busy by default\n"
+                 "  --verify                also renders each split file in one piece and checks the two match bit for bit\n"
+                 "  --memory-budget <MB>    memory renders may hold at once; 1024 by default\n"
+                 "  --block-size <n>        samples per processBlock call; 512 by default\n";
+}
+
+int main(int argc, char* argv[])
+{
+    // the processor's parameters expect a message manager, even though no message loop ever runs
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::ArgumentList arguments(argc, argv);
+    BatchRenderer::Settings settings;
+    juce::Array<juce::File> files;
+
+    for (int i = 0; i < arguments.size(); ++i) {
+        const auto& argument = arguments[i];
+
+        if (argument == "--help" || argument == "-h") {
+            printUsage();
+            return 0;
+        }
+
+        if (!argument.isLongOption()) {
+            files.add(argument.resolveAsFile());
+            continue;
+        }
+
+        if (argument == "--verify") {
+            settings.verify = true;
+            continue;
+        }
+
+        if (i + 1 >= arguments.size()) {
+            std::cerr << "missing value for " << argument.text << "\n";
+            return 1;
+        }
+
+        const auto option = argument.text.substring(2);
+        const auto value = arguments[++i].text;
+
+        if (option == "output-dir") {
+            settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            settings.outputDirectory.createDirectory();
+        } else if (option == "suffix") {
+            settings.outputSuffix = value;
+        } else if (option == "state") {
+            settings.state = juce::parseXML(juce::File::getCurrentWorkingDirectory().getChildFile(value));
+
+            if (settings.state == nullptr) {
+                std::cerr << "cannot read state " << value << "\n";
+                return 1;
+            }
+        } else if (option == "threads") {
+            settings.numThreads = juce::jmax(1, value.getIntValue());
+        } else if (option == "memory-budget") {
+            settings.memoryBudgetBytes = static_cast<size_t>(juce::jmax(1, value.getIntValue())) << 20;
+        } else if (option == "segments") {
+            settings.numSegments = juce::jmax(1, value.getIntValue());
+        } else if (option == "block-size") {
+            settings.blockSize = juce::jmax(1, value.getIntValue());
+        } else {
+            settings.parameters.set(option, value);
+        }
+    }
+
+    if (files.isEmpty()) {
+        printUsage();
+        return 1;
+    }
+
+    BatchRenderer renderer(std::move(settings));
+    std::mutex outputLock;
+
+    const auto results = renderer.render(files, [&outputLock](const BatchRenderer::Result& result) {
+        const std::lock_guard<std::mutex> lock(outputLock);
+
+        if (result.error.isNotEmpty()) {
+            std::cerr << result.input.getFullPathName() << ": " << result.error << "\n";
+        } else {
+            std::cout << result.input.getFullPathName() << " -> " << result.output.getFullPathName() << ": "
+                      << juce::String(result.audioSeconds, 2) << " s in " << juce::String(result.renderSeconds, 2) << " s, "
+                      << juce::String(result.getRealtimeMultiple(), 1) << "x realtime";
+
+            if (result.numSegments > 1) {
+                std::cout << " in " << result.numSegments << " segments" << (result.isVerified ? ", identical to a serial render" : "");
+            }
+
+            std::cout << "\n";
+        }
+    });
+
+    const auto numFailed = std::count_if(results.begin(), results.end(), [](const BatchRenderer::Result& result) { return result.error.isNotEmpty(); });
+
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,437 @@
+#include "EngineBenchmarks.h"
+
+#include "../../Source/CircularBuffer.h"
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/ScopedNoAllocation.h"
+
+// a spectral processor that leaves the bins alone, so only the engine is timed
+static const auto passThrough = [](std::complex<float>*, unsigned) {};
+
+static constexpr double sampleRate = 48000.0;
+
+// returns false if the processor has no such parameter or value
+static bool setParameter(juce::AudioProcessor& processor, const juce::String& parameterID, const juce::String& text)
+{
+    for (auto* parameter : processor.getParameters()) {
+        if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter); withID != nullptr && withID->paramID == parameterID) {
+            parameter->setValueNotifyingHost(parameter->getValueForText(text));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// a processor set up the way a host would have it for the case
+static std::unique_ptr<PluginProcessor> createProcessor(int fftOrder, int numOverlaps, int blockSize, int numChannels, FFTScheduling scheduling)
+{
+    auto processor = std::make_unique<PluginProcessor>();
+
+    setParameter(*processor, "fftSize", juce::String(1 << fftOrder));
+    setParameter(*processor, "overlap", juce::String(numOverlaps) + "x");
+
+    // offline rendering picks the batched mode whatever the parameter says
+    if (scheduling == FFTScheduling::batched) {
+        processor->setNonRealtime(true);
+    } else {
+        setParameter(*processor, "scheduling", juce::StringArray{ "Immediate", "Worker thread", "Amortized" }[static_cast<int>(scheduling)]);
+    }
+
+    processor->setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+    processor->prepareToPlay(sampleRate, blockSize);
+
+    return processor;
+}
+
+static void fillWithNoise(juce::AudioBuffer<float>& buffer)
+{
+    juce::Random random(1);
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+        float* samples = buffer.getWritePointer(channel);
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i) {
+            samples[i] = random.nextFloat() * 2.f - 1.f;
+        }
+    }
+}
+
+// enough blocks for the input ring to fill and the first results to come out
+template<typename Block>
+static void warmUp(Block& block, int numSamplesPerBlock, int fftOrder)
+{
+    const int numWarmUpSamples = 4 << fftOrder;
+
+    for (int numProcessed = 0; numProcessed < numWarmUpSamples; numProcessed += numSamplesPerBlock) {
+        block();
+    }
+}
+
+EngineBenchmarks::EngineBenchmarks(Settings settings)
+  : m_settings(std::move(settings))
+{
+}
+
+juce::StringArray EngineBenchmarks::getBenchmarkNames()
+{
+    return { "fftBuffer.writeReadResult", "fftBuffer.process", "performFFT", "processFFT", "circularBuffer.write", "processBlock", "workerPool" };
+}
+
+juce::var EngineBenchmarks::run(std::function<void(const juce::String&)> reportProgress)
+{
+    m_results.clear();
+
+    auto report = [&reportProgress](const juce::String& text) {
+        if (reportProgress) {
+            reportProgress(text);
+        }
+    };
+
+    if (this->isSelected("circularBuffer.write")) {
+        for (const int blockSize : m_settings.blockSizes) {
+            report("circularBuffer.write, block " + juce::String(blockSize));
+            this->benchmarkCircularBufferWrite(blockSize);
+        }
+    }
+
+    // one for every core besides the caller's, and the counts on the way there
+    juce::Array<int> workerCounts{ 0 };
+
+    for (int numWorkers = 1; numWorkers < juce::SystemStats::getNumCpus(); numWorkers *= 2) {
+        workerCounts.add(numWorkers);
+    }
+
+    if (!workerCounts.contains(juce::SystemStats::getNumCpus() - 1)) {
+        workerCounts.add(juce::SystemStats::getNumCpus() - 1);
+    }
+
+    for (const int fftOrder : m_settings.fftOrders) {
+        for (const int numOverlaps : m_settings.overlaps) {
+            const juce::String geometry = "order " + juce::String(fftOrder) + ", overlap " + juce::String(numOverlaps);
+
+            for (const int numChannels : m_settings.channelCounts) {
+                const juce::String layout = ", channels " + juce::String(numChannels);
+
+                if (this->isSelected("performFFT")) {
+                    report("performFFT, " + geometry + layout);
+                    this->benchmarkPerformFFT(fftOrder, numOverlaps, numChannels);
+                }
+
+                if (this->isSelected("processFFT")) {
+                    report("processFFT, " + geometry + layout);
+                    this->benchmarkProcessFFT(fftOrder, numOverlaps, numChannels);
+                }
+            }
+
+            for (const int blockSize : m_settings.blockSizes) {
+                const juce::String block = ", block " + juce::String(blockSize);
+
+                if (this->isSelected("fftBuffer.writeReadResult")) {
+                    report("fftBuffer.writeReadResult, " + geometry + block);
+                    this->benchmarkWriteReadResult(fftOrder, numOverlaps, blockSize);
+                }
+
+                for (const int numChannels : m_settings.channelCounts) {
+                    const juce::String layout = ", channels " + juce::String(numChannels);
+
+                    for (const auto scheduling : m_settings.schedulings) {
+                        const juce::String mode = ", " + getSchedulingName(scheduling);
+
+                        if (this->isSelected("fftBuffer.process")) {
+                            report("fftBuffer.process, " + geometry + block + layout + mode);
+                            this->benchmarkProcess(fftOrder, numOverlaps, blockSize, numChannels, scheduling);
+                        }
+
+                        if (this->isSelected("processBlock")) {
+                            report("processBlock, " + geometry + block + layout + mode);
+                            this->benchmarkProcessBlock(fftOrder, numOverlaps, blockSize, numChannels, scheduling);
+                        }
+                    }
+
+                    // below this the channels are never spread over the pool
+                    if (this->isSelected("workerPool") && numChannels >= static_cast<int>(FFTBuffer::minParallelChannels)) {
+                        for (const int numWorkers : workerCounts) {
+                            report("workerPool, " + geometry + block + layout + ", workers " + juce::String(numWorkers));
+                            this->benchmarkWorkerPool(fftOrder, numOverlaps, blockSize, numChannels, numWorkers);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    auto* benchmarks = new juce::DynamicObject();
+    benchmarks->setProperty("build", getBuildDetails());
+    benchmarks->setProperty("results", m_results);
+
+    return benchmarks;
+}
+
+juce::var EngineBenchmarks::getBuildDetails()
+{
+#if JUCE_DEBUG
+    const bool isDebug = true;
+#else
+    const bool isDebug = false;
+#endif
+
+    auto* build = new juce::DynamicObject();
+    build->setProperty("juceVersion", juce::SystemStats::getJUCEVersion());
+    build->setProperty("debug", isDebug);
+    build->setProperty("countsAllocations", ScopedNoAllocation::countsAllocations);
+    build->setProperty("countedAllocators", juce::String(ScopedNoAllocation::countedAllocators));
+    build->setProperty("cpu", juce::SystemStats::getCpuModel());
+    build->setProperty("numCpus", juce::SystemStats::getNumCpus());
+    build->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+
+    return build;
+}
+
+bool EngineBenchmarks::isSelected(const juce::String& benchmark) const
+{
+    return m_settings.benchmarks.isEmpty() || m_settings.benchmarks.contains(benchmark);
+}
+
+// runs prepare and then block until the case has had its time, timing each block on its own; allocations are counted
+// across the whole process, so anything another thread allocates meanwhile is included
+template<typename Block, typename Prepare>
+EngineBenchmarks::Timing EngineBenchmarks::timeBlocks(Block& block, Prepare& prepare, int numSamplesPerBlock) const
+{
+    const juce::int64 minBlocks = 16;
+    const double nsPerTick = 1.0e9 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    const double maxTicks = m_settings.secondsPerCase * 1.0e9 / nsPerTick;
+
+    Timing timing;
+    juce::int64 numTicks = 0;
+    juce::int64 worstTicks = 0;
+    juce::int64 numAllocations = 0;
+
+    while (static_cast<double>(numTicks) < maxTicks || timing.numBlocks < minBlocks) {
+        prepare();
+
+        const juce::int64 startAllocations = ScopedNoAllocation::getNumAllocations();
+        const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+
+        block();
+
+        const juce::int64 blockTicks = juce::Time::getHighResolutionTicks() - startTicks;
+        numAllocations += ScopedNoAllocation::getNumAllocations() - startAllocations;
+
+        numTicks += blockTicks;
+        worstTicks = juce::jmax(worstTicks, blockTicks);
+        ++timing.numBlocks;
+    }
+
+    const double numBlocks = static_cast<double>(timing.numBlocks);
+
+    timing.meanBlockNs = static_cast<double>(numTicks) * nsPerTick / numBlocks;
+    timing.nsPerSample = timing.meanBlockNs / numSamplesPerBlock;
+    timing.worstBlockNs = static_cast<double>(worstTicks) * nsPerTick;
+    timing.allocationsPerBlock = static_cast<double>(numAllocations) / numBlocks;
+
+    return timing;
+}
+
+void EngineBenchmarks::addResult(const juce::String& benchmark, const Timing& timing, juce::NamedValueSet configuration)
+{
+    auto* result = new juce::DynamicObject();
+    result->setProperty("benchmark", benchmark);
+
+    for (const auto& property : configuration) {
+        result->setProperty(property.name, property.value);
+    }
+
+    result->setProperty("numBlocks", timing.numBlocks);
+    result->setProperty("nsPerSample", timing.nsPerSample);
+    result->setProperty("meanBlockNs", timing.meanBlockNs);
+    result->setProperty("worstBlockNs", timing.worstBlockNs);
+    result->setProperty("allocationsPerBlock", timing.allocationsPerBlock);
+
+    m_results.add(result);
+}
+
+// the per-sample interface, one channel, reading each result before writing the next sample
+void EngineBenchmarks::benchmarkWriteReadResult(int fftOrder, int numOverlaps, int blockSize)
+{
+    FFTBuffer fftBuffer(1, static_cast<unsigned>(fftOrder), static_cast<unsigned>(numOverlaps), passThrough);
+
+    juce::AudioBuffer<float> input(1, blockSize);
+    juce::AudioBuffer<float> output(1, blockSize);
+    fillWithNoise(input);
+
+    auto block = [&] {
+        const float* inputData = input.getReadPointer(0);
+        float* outputData = output.getWritePointer(0);
+
+        for (int i = 0; i < blockSize; ++i) {
+            outputData[i] = fftBuffer.readResult(0);
+            fftBuffer.write(0, inputData[i]);
+        }
+    };
+    auto prepare = [] {};
+
+    warmUp(block, blockSize, fftOrder);
+    this->addResult(
+        "fftBuffer.writeReadResult", this->timeBlocks(block, prepare, blockSize), { { "fftOrder", fftOrder }, { "overlap", numOverlaps }, { "blockSize", blockSize } });
+}
+
+// the block interface on its own, with the pool the plugin would give it
+void EngineBenchmarks::benchmarkProcess(int fftOrder, int numOverlaps, int blockSize, int numChannels, FFTScheduling scheduling)
+{
+    FFTBuffer fftBuffer(static_cast<unsigned>(numChannels), static_cast<unsigned>(fftOrder), static_cast<unsigned>(numOverlaps), passThrough);
+    fftBuffer.setWorkerPool(&m_workerPool.get());
+    fftBuffer.prepareScheduling(scheduling);
+    fftBuffer.setScheduling(scheduling);
+
+    juce::AudioBuffer<float> input(numChannels, blockSize);
+    juce::AudioBuffer<float> output(numChannels, blockSize);
+    fillWithNoise(input);
+
+    auto block = [&] { fftBuffer.process(input.getArrayOfReadPointers(), output.getArrayOfWritePointers(), blockSize); };
+    auto prepare = [] {};
+
+    warmUp(block, blockSize, fftOrder);
+    this->addResult("fftBuffer.process",
+                    this->timeBlocks(block, prepare, blockSize),
+                    { { "fftOrder", fftOrder },
+                      { "overlap", numOverlaps },
+                      { "blockSize", blockSize },
+                      { "numChannels", numChannels },
+                      { "scheduling", getSchedulingName(scheduling) } });
+}
+
+// a hop per block, each of which completes one frame of every channel; nsPerSample is then a frame's cost spread over
+// the hop it covers
+void EngineBenchmarks::benchmarkPerformFFT(int fftOrder, int numOverlaps, int numChannels)
+{
+    const int hopSize = (1 << fftOrder) / numOverlaps;
+
+    FFTBuffer fftBuffer(static_cast<unsigned>(numChannels), static_cast<unsigned>(fftOrder), static_cast<unsigned>(numOverlaps), passThrough);
+
+    juce::AudioBuffer<float> input(numChannels, hopSize);
+    juce::AudioBuffer<float> output(numChannels, hopSize);
+    fillWithNoise(input);
+
+    auto block = [&] { fftBuffer.process(input.getArrayOfReadPointers(), output.getArrayOfWritePointers(), hopSize); };
+    auto prepare = [] {};
+
+    warmUp(block, hopSize, fftOrder);
+    this->addResult("performFFT",
+                    this->timeBlocks(block, prepare, hopSize),
+                    { { "fftOrder", fftOrder }, { "overlap", numOverlaps }, { "blockSize", hopSize }, { "numChannels", numChannels } });
+}
+
+// the plugin's spectral processing of one frame of every channel, with the gain tables already built; the spectra are
+// restored between blocks so that repeated filtering never decays them into denormals
+void EngineBenchmarks::benchmarkProcessFFT(int fftOrder, int numOverlaps, int numChannels)
+{
+    const int fftSize = 1 << fftOrder;
+    const int hopSize = fftSize / numOverlaps;
+
+    auto processor = createProcessor(fftOrder, numOverlaps, hopSize, numChannels, FFTScheduling::immediate);
+    auto& engine = *processor->m_engine.load();
+
+    // real-only transforms leave fftSize / 2 + 1 interleaved bins in a buffer of twice the window
+    juce::AudioBuffer<float> spectra(numChannels, 2 * fftSize);
+    juce::AudioBuffer<float> workspace(numChannels, 2 * fftSize);
+    fillWithNoise(spectra);
+
+    auto block = [&] {
+        for (int channel = 0; channel < numChannels; ++channel) {
+            auto* bins = reinterpret_cast<std::complex<float>*>(workspace.getWritePointer(channel));
+            processor->processFFT(engine, bins, static_cast<unsigned>(channel));
+        }
+    };
+    auto prepare = [&] { workspace.makeCopyOf(spectra, true); };
+
+    prepare();
+    block();
+
+    this->addResult("processFFT",
+                    this->timeBlocks(block, prepare, hopSize),
+                    { { "fftOrder", fftOrder }, { "overlap", numOverlaps }, { "blockSize", hopSize }, { "numChannels", numChannels } });
+}
+
+// the display's audio history, one channel at the size the plugin gives it
+void EngineBenchmarks::benchmarkCircularBufferWrite(int blockSize)
+{
+    CircularBuffer<float> circularBuffer(1024);
+
+    juce::AudioBuffer<float> input(1, blockSize);
+    fillWithNoise(input);
+
+    auto block = [&] { circularBuffer.write(input.getReadPointer(0), static_cast<uint32_t>(blockSize)); };
+    auto prepare = [] {};
+
+    this->addResult("circularBuffer.write", this->timeBlocks(block, prepare, blockSize), { { "blockSize", blockSize } });
+}
+
+// the whole plugin as a host drives it, refilling the block with fresh input each time
+void EngineBenchmarks::benchmarkProcessBlock(int fftOrder, int numOverlaps, int blockSize, int numChannels, FFTScheduling scheduling)
+{
+    auto processor = createProcessor(fftOrder, numOverlaps, blockSize, numChannels, scheduling);
+
+    juce::AudioBuffer<float> input(numChannels, blockSize);
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+    juce::MidiBuffer midiMessages;
+    fillWithNoise(input);
+
+    auto block = [&] { processor->processBlock(buffer, midiMessages); };
+    auto prepare = [&] { buffer.makeCopyOf(input, true); };
+
+    for (int numProcessed = 0; numProcessed < 4 << fftOrder; numProcessed += blockSize) {
+        prepare();
+        block();
+    }
+
+    this->addResult("processBlock",
+                    this->timeBlocks(block, prepare, blockSize),
+                    { { "fftOrder", fftOrder },
+                      { "overlap", numOverlaps },
+                      { "blockSize", blockSize },
+                      { "numChannels", numChannels },
+                      { "scheduling", getSchedulingName(scheduling) } });
+
+    processor->releaseResources();
+}
+
+// the channel-parallel block interface on a pool of its own, to see how it scales with the worker count
+void EngineBenchmarks::benchmarkWorkerPool(int fftOrder, int numOverlaps, int blockSize, int numChannels, int numWorkers)
+{
+    RealtimeWorkerPool workerPool(numWorkers);
+
+    FFTBuffer fftBuffer(static_cast<unsigned>(numChannels), static_cast<unsigned>(fftOrder), static_cast<unsigned>(numOverlaps), passThrough);
+    fftBuffer.setWorkerPool(&workerPool);
+
+    juce::AudioBuffer<float> input(numChannels, blockSize);
+    juce::AudioBuffer<float> output(numChannels, blockSize);
+    fillWithNoise(input);
+
+    auto block = [&] { fftBuffer.process(input.getArrayOfReadPointers(), output.getArrayOfWritePointers(), blockSize); };
+    auto prepare = [] {};
+
+    warmUp(block, blockSize, fftOrder);
+    this->addResult("workerPool",
+                    this->timeBlocks(block, prepare, blockSize),
+                    { { "fftOrder", fftOrder },
+                      { "overlap", numOverlaps },
+                      { "blockSize", blockSize },
+                      { "numChannels", numChannels },
+                      { "numWorkers", numWorkers } });
+}
+
+juce::String EngineBenchmarks::getSchedulingName(FFTScheduling scheduling)
+{
+    switch (scheduling) {
+        case FFTScheduling::immediate:
+            return "immediate";
+        case FFTScheduling::worker:
+            return "worker";
+        case FFTScheduling::amortized:
+            return "amortized";
+        case FFTScheduling::batched:
+            return "batched";
+    }
+
+    return {};
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "../../Source/FFTBuffer.h"
+
+// times the spectral engine's hot paths over a grid of FFT orders, overlaps, host block sizes and channel counts, and
+// reports every case as JSON so that builds can be compared; each case is timed block by block, after a warm-up long
+// enough for the engine to be producing output
+class EngineBenchmarks
+{
+  public:
+    struct Settings
+    {
+        // empty runs every benchmark
+        juce::StringArray benchmarks;
+
+        juce::Array<int> fftOrders{ 8, 10, 12, 14 };
+        juce::Array<int> overlaps{ 2, 4, 8 };
+        juce::Array<int> blockSizes{ 16, 64, 256, 1024, 4096, 8192 };
+        juce::Array<int> channelCounts{ 1, 2, 6, 12 };
+        juce::Array<FFTScheduling> schedulings{ FFTScheduling::immediate };
+
+        // how long each case is timed for, at least
+        double secondsPerCase = 0.1;
+    };
+
+    explicit EngineBenchmarks(Settings settings);
+
+    static juce::StringArray getBenchmarkNames();
+
+    // the machine and build the results came from
+    static juce::var getBuildDetails();
+
+    // runs the selected benchmarks; the result is an object with the build's details under "build" and one object per
+    // case under "results", with reportProgress called before each case
+    juce::var run(std::function<void(const juce::String&)> reportProgress = {});
+
+  private:
+    struct Timing
+    {
+        juce::int64 numBlocks = 0;
+        double nsPerSample = 0.0;
+        double meanBlockNs = 0.0;
+        double worstBlockNs = 0.0;
+        double allocationsPerBlock = 0.0;
+    };
+
+    const Settings m_settings;
+    juce::Array<juce::var> m_results;
+
+    // the pool the plugin itself would share, for the benchmarks that are not about the pool
+    juce::SharedResourcePointer<RealtimeWorkerPool> m_workerPool;
+
+    bool isSelected(const juce::String& benchmark) const;
+
+    template<typename Block, typename Prepare>
+    Timing timeBlocks(Block& block, Prepare& prepare, int numSamplesPerBlock) const;
+
+    void addResult(const juce::String& benchmark, const Timing& timing, juce::NamedValueSet configuration);
+
+    void benchmarkWriteReadResult(int fftOrder, int numOverlaps, int blockSize);
+    void benchmarkProcess(int fftOrder, int numOverlaps, int blockSize, int numChannels, FFTScheduling scheduling);
+    void benchmarkPerformFFT(int fftOrder, int numOverlaps, int numChannels);
+    void benchmarkProcessFFT(int fftOrder, int numOverlaps, int numChannels);
+    void benchmarkCircularBufferWrite(int blockSize);
+    void benchmarkProcessBlock(int fftOrder, int numOverlaps, int blockSize, int numChannels, FFTScheduling scheduling);
+    void benchmarkWorkerPool(int fftOrder, int numOverlaps, int blockSize, int numChannels, int numWorkers);
+
+    static juce::String getSchedulingName(FFTScheduling scheduling);
+};
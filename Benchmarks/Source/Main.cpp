@@ -0,0 +1,351 @@
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "../../Source/PluginProcessor.h"
+#include "EngineBenchmarks.h"
+#include "SessionBenchmark.h"
+
+static void printUsage()
+{
+    std::cout << "usage: Benchmarks [options]\n"
+                 "       Benchmarks --session [options]\n"
+                 "       Benchmarks --scaling [options]\n"
+                 "\n"
+                 "times the spectral engine, or a whole session of instances, and prints the results as JSON\n"
+                 "\n"
+                 "engine benchmarks:\n"
+                 "  --benchmarks <names>    comma-separated; all by default: "
+              << EngineBenchmarks::getBenchmarkNames().joinIntoString(", ")
+              << "\n"
+                 "  --orders <list>         FFT orders; 8,10,12,14 by default\n"
+                 "  --overlaps <list>       overlaps; 2,4,8 by default\n"
+                 "  --block-sizes <list>    host block sizes; 16,64,256,1024,4096,8192 by default\n"
+                 "  --channels <list>       channel counts; 1,2,6,12 by default\n"
+                 "  --scheduling <list>     immediate, worker, amortized or batched; immediate by default\n"
+                 "  --seconds <s>           time spent on each case, at least; 0.1 by default\n"
+                 "\n"
+                 "session benchmark, many instances driven by a fake host:\n"
+                 "  --instances <n>         instances in the session; 100 by default\n"
+                 "  --threads <n>           host audio threads sharing them; all cores by default\n"
+                 "  --pool-workers <n>      workers in the shared pool, 0 keeping the instances out of it; one per core\n"
+                 "                          besides the caller's by default\n"
+                 "  --channels <n>          channels per instance; 2 by default\n"
+                 "  --block-size <n>        host block size; 512 by default\n"
+                 "  --sample-rate <hz>      48000 by default\n"
+                 "  --deadline-ms <ms>      how long after a block is due its shares must be done; the block's duration by default\n"
+                 "  --seconds <s>           how long the session runs; 10 by default\n"
+                 "  --<parameter> <value>   a parameter by ID for every instance, as the plugin shows it: --fftSize 2048\n"
+                 "\n"
+                 "scaling benchmark, a session for every instance count and pool worker count:\n"
+                 "  --instances <list>      instance counts; 1,2,4,8,16,32,64 by default\n"
+                 "  --pool-workers <list>   worker counts; 0, the powers of two below one per core besides the caller's, and\n"
+                 "                          that by default\n"
+                 "  and the other session options, e.g. --threads 1 for a host running every instance on one thread\n"
+                 "\n"
+                 "  --output <file>         where the JSON goes; standard output by default\n";
+}
+
+static juce::Array<int> parseIntegers(const juce::String& text)
+{
+    juce::Array<int> values;
+
+    for (const auto& token : juce::StringArray::fromTokens(text, ",", "")) {
+        values.add(token.getIntValue());
+    }
+
+    return values;
+}
+
+// returns false if any name is not a scheduling mode
+static bool parseSchedulings(const juce::String& text, juce::Array<FFTScheduling>& schedulings)
+{
+    const juce::StringArray names{ "immediate", "worker", "amortized", "batched" };
+    schedulings.clear();
+
+    for (const auto& token : juce::StringArray::fromTokens(text, ",", "")) {
+        const int index = names.indexOf(token.trim());
+
+        if (index < 0) {
+            return false;
+        }
+
+        schedulings.add(static_cast<FFTScheduling>(index));
+    }
+
+    return !schedulings.isEmpty();
+}
+
+// calls handleOption(option, value) for every option and its value, skipping the flags; returns false, having said
+// why, on a malformed argument or if handleOption does
+static bool parseOptions(const juce::ArgumentList& arguments, std::function<bool(const juce::String&, const juce::String&)> handleOption)
+{
+    for (int i = 0; i < arguments.size(); ++i) {
+        const auto& argument = arguments[i];
+
+        if (argument == "--session" || argument == "--scaling") {
+            continue;
+        }
+
+        if (!argument.isLongOption()) {
+            std::cerr << "unexpected argument " << argument.text << "\n";
+            return false;
+        }
+
+        if (i + 1 >= arguments.size()) {
+            std::cerr << "missing value for " << argument.text << "\n";
+            return false;
+        }
+
+        const auto option = argument.text.substring(2);
+
+        if (!handleOption(option, arguments[++i].text)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// progress goes to the error stream, so that the JSON on standard output stays parseable
+static int writeResults(const juce::var& results, const juce::File& outputFile)
+{
+    const auto json = juce::JSON::toString(results);
+
+    if (outputFile == juce::File()) {
+        std::cout << json << "\n";
+    } else if (!outputFile.replaceWithText(json + "\n")) {
+        std::cerr << "cannot write " << outputFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+static int runEngineBenchmarks(const juce::ArgumentList& arguments)
+{
+    EngineBenchmarks::Settings settings;
+    juce::File outputFile;
+
+    const bool isParsed = parseOptions(arguments, [&settings, &outputFile](const juce::String& option, const juce::String& value) {
+        if (option == "benchmarks") {
+            settings.benchmarks = juce::StringArray::fromTokens(value, ",", "");
+            settings.benchmarks.trim();
+
+            for (const auto& benchmark : settings.benchmarks) {
+                if (!EngineBenchmarks::getBenchmarkNames().contains(benchmark)) {
+                    std::cerr << "unknown benchmark " << benchmark << "\n";
+                    return false;
+                }
+            }
+        } else if (option == "orders") {
+            settings.fftOrders = parseIntegers(value);
+        } else if (option == "overlaps") {
+            settings.overlaps = parseIntegers(value);
+        } else if (option == "block-sizes") {
+            settings.blockSizes = parseIntegers(value);
+        } else if (option == "channels") {
+            settings.channelCounts = parseIntegers(value);
+        } else if (option == "scheduling") {
+            if (!parseSchedulings(value, settings.schedulings)) {
+                std::cerr << "unknown scheduling " << value << "\n";
+                return false;
+            }
+        } else if (option == "seconds") {
+            settings.secondsPerCase = juce::jmax(0.0, value.getDoubleValue());
+        } else if (option == "output") {
+            outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+        } else {
+            std::cerr << "unknown option --" << option << "\n";
+            return false;
+        }
+
+        return true;
+    });
+
+    if (!isParsed) {
+        return 1;
+    }
+
+    for (const int fftOrder : settings.fftOrders) {
+        if (fftOrder < static_cast<int>(FFTBuffer::minFFTOrder) || fftOrder > static_cast<int>(FFTBuffer::maxFFTOrder)) {
+            std::cerr << "FFT orders run from " << FFTBuffer::minFFTOrder << " to " << FFTBuffer::maxFFTOrder << "\n";
+            return 1;
+        }
+    }
+
+    for (const int numOverlaps : settings.overlaps) {
+        if (numOverlaps != 2 && numOverlaps != 4 && numOverlaps != 8) {
+            std::cerr << "overlaps are 2, 4 or 8\n";
+            return 1;
+        }
+    }
+
+    for (const int numChannels : settings.channelCounts) {
+        if (numChannels < 1 || numChannels > MAX_CHANNELS) {
+            std::cerr << "channel counts run from 1 to " << MAX_CHANNELS << "\n";
+            return 1;
+        }
+    }
+
+    for (const int blockSize : settings.blockSizes) {
+        if (blockSize < 1) {
+            std::cerr << "block sizes must be positive\n";
+            return 1;
+        }
+    }
+
+    EngineBenchmarks benchmarks(std::move(settings));
+
+    return writeResults(benchmarks.run([](const juce::String& benchmark) { std::cerr << benchmark << "\n"; }), outputFile);
+}
+
+// anything that is not a session option is taken as a parameter ID
+static void applySessionOption(SessionBenchmark::Settings& settings, const juce::String& option, const juce::String& value)
+{
+    if (option == "instances") {
+        settings.numInstances = juce::jmax(1, value.getIntValue());
+    } else if (option == "threads") {
+        settings.numHostThreads = juce::jmax(1, value.getIntValue());
+    } else if (option == "pool-workers") {
+        settings.numPoolWorkers = juce::jmax(0, value.getIntValue());
+    } else if (option == "channels") {
+        settings.numChannels = juce::jlimit(1, static_cast<int>(MAX_CHANNELS), value.getIntValue());
+    } else if (option == "block-size") {
+        settings.blockSize = juce::jmax(1, value.getIntValue());
+    } else if (option == "sample-rate") {
+        settings.sampleRate = juce::jmax(1.0, value.getDoubleValue());
+    } else if (option == "deadline-ms") {
+        settings.deadlineMs = juce::jmax(0.0, value.getDoubleValue());
+    } else if (option == "seconds") {
+        settings.seconds = juce::jmax(0.0, value.getDoubleValue());
+    } else {
+        settings.parameters.set(option, value);
+    }
+}
+
+static int runSessionBenchmark(const juce::ArgumentList& arguments)
+{
+    SessionBenchmark::Settings settings;
+    juce::File outputFile;
+
+    const bool isParsed = parseOptions(arguments, [&settings, &outputFile](const juce::String& option, const juce::String& value) {
+        if (option == "output") {
+            outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+        } else {
+            applySessionOption(settings, option, value);
+        }
+
+        return true;
+    });
+
+    if (!isParsed) {
+        return 1;
+    }
+
+    SessionBenchmark benchmark(std::move(settings));
+    std::cerr << "creating the session\n";
+
+    if (const auto result = benchmark.createSession(); result.failed()) {
+        std::cerr << result.getErrorMessage() << "\n";
+        return 1;
+    }
+
+    return writeResults(benchmark.run([](const juce::String& stage) { std::cerr << stage << "\n"; }), outputFile);
+}
+
+// 0, then every power of two below one worker per core besides the caller's, then that
+static juce::Array<int> getDefaultPoolWorkerCounts()
+{
+    const int maxNumWorkers = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+    juce::Array<int> workerCounts{ 0 };
+
+    for (int numWorkers = 1; numWorkers < maxNumWorkers; numWorkers *= 2) {
+        workerCounts.add(numWorkers);
+    }
+
+    workerCounts.add(maxNumWorkers);
+    return workerCounts;
+}
+
+// runs one session per instance count and worker count, each with a pool of its own, since a session's pool stops with
+// its last instance
+static int runScalingBenchmark(const juce::ArgumentList& arguments)
+{
+    SessionBenchmark::Settings settings;
+    juce::Array<int> instanceCounts{ 1, 2, 4, 8, 16, 32, 64 };
+    juce::Array<int> workerCounts = getDefaultPoolWorkerCounts();
+    juce::File outputFile;
+
+    const bool isParsed = parseOptions(arguments, [&](const juce::String& option, const juce::String& value) {
+        if (option == "instances") {
+            instanceCounts = parseIntegers(value);
+        } else if (option == "pool-workers") {
+            workerCounts = parseIntegers(value);
+        } else if (option == "output") {
+            outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+        } else {
+            applySessionOption(settings, option, value);
+        }
+
+        return true;
+    });
+
+    if (!isParsed) {
+        return 1;
+    }
+
+    const bool areCountsValid = std::all_of(instanceCounts.begin(), instanceCounts.end(), [](int count) { return count >= 1; })
+                                && std::all_of(workerCounts.begin(), workerCounts.end(), [](int count) { return count >= 0; });
+
+    if (!areCountsValid) {
+        std::cerr << "instance counts must be positive and worker counts at least 0\n";
+        return 1;
+    }
+
+    juce::Array<juce::var> sessions;
+
+    for (const int numWorkers : workerCounts) {
+        for (const int numInstances : instanceCounts) {
+            auto sessionSettings = settings;
+            sessionSettings.numInstances = numInstances;
+            sessionSettings.numPoolWorkers = numWorkers;
+
+            SessionBenchmark benchmark(std::move(sessionSettings));
+            std::cerr << "creating " << numInstances << " instances with " << numWorkers << " pool workers\n";
+
+            if (const auto result = benchmark.createSession(); result.failed()) {
+                std::cerr << result.getErrorMessage() << "\n";
+                return 1;
+            }
+
+            sessions.add(benchmark.run([](const juce::String& stage) { std::cerr << stage << "\n"; })["session"]);
+        }
+    }
+
+    auto* scaling = new juce::DynamicObject();
+    scaling->setProperty("build", EngineBenchmarks::getBuildDetails());
+    scaling->setProperty("sessions", sessions);
+
+    return writeResults(scaling, outputFile);
+}
+
+int main(int argc, char* argv[])
+{
+    // the processor's parameters expect a message manager, even though no message loop ever runs
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::ArgumentList arguments(argc, argv);
+
+    if (arguments.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    if (arguments.containsOption("--scaling")) {
+        return runScalingBenchmark(arguments);
+    }
+
+    return arguments.containsOption("--session") ? runSessionBenchmark(arguments) : runEngineBenchmarks(arguments);
+}
@@ -0,0 +1,359 @@
+#include "SessionBenchmark.h"
+
+#include "../../Source/PluginProcessor.h"
+#include "EngineBenchmarks.h"
+
+#include <chrono>
+#include <thread>
+
+#if JUCE_LINUX
+#include <unistd.h>
+#elif JUCE_MAC
+#include <mach/mach.h>
+#endif
+
+// defined by the plugin, as it would be found by a host
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter();
+
+using Clock = std::chrono::steady_clock;
+
+static double getMicroseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+// one of the host's audio threads: processes its instances one after another once per host block, sleeping until each
+// block is due; everything it records is reserved up front
+class SessionBenchmark::HostThread : public juce::Thread
+{
+  public:
+    HostThread(SessionBenchmark& owner, std::vector<int> instances, int numBlocks, Clock::time_point start)
+      : juce::Thread("SessionBenchmark host")
+      , m_owner(owner)
+      , m_instances(std::move(instances))
+      , m_numBlocks(numBlocks)
+      , m_start(start)
+    {
+        m_processDurations.reserve(m_instances.size() * static_cast<size_t>(numBlocks));
+        m_hostBlockDurations.reserve(static_cast<size_t>(numBlocks));
+        m_finishDelays.reserve(static_cast<size_t>(numBlocks));
+        m_midiMessages.ensureSize(2048);
+    }
+
+    ~HostThread() override { this->stopThread(1000); }
+
+    void run() override
+    {
+        const std::chrono::duration<double> blockPeriod(m_owner.m_settings.blockSize / m_owner.m_settings.sampleRate);
+
+        for (int block = 0; block < m_numBlocks && !this->threadShouldExit(); ++block) {
+            // a thread that has fallen behind starts its next block straight away, late, as a host's would
+            const auto blockDue = m_start + std::chrono::duration_cast<Clock::duration>(blockPeriod * block);
+            std::this_thread::sleep_until(blockDue);
+
+            const auto blockStart = Clock::now();
+
+            for (const int instance : m_instances) {
+                // fresh input each block, as the host's graph would deliver it
+                auto& buffer = m_owner.m_buffers[static_cast<size_t>(instance)];
+                buffer.makeCopyOf(m_owner.m_input, true);
+                m_midiMessages.clear();
+
+                const auto processStart = Clock::now();
+                m_owner.m_instances[static_cast<size_t>(instance)]->processBlock(buffer, m_midiMessages);
+                m_processDurations.push_back(getMicroseconds(Clock::now() - processStart));
+            }
+
+            const auto blockEnd = Clock::now();
+            m_hostBlockDurations.push_back(getMicroseconds(blockEnd - blockStart));
+            m_finishDelays.push_back(getMicroseconds(blockEnd - blockDue));
+        }
+    }
+
+    // in microseconds, once the thread has finished; a block's finish delay runs from when it was due until its share
+    // was done, and so includes any time spent waiting behind earlier blocks
+    std::vector<double>& getProcessDurations() { return m_processDurations; }
+    std::vector<double>& getHostBlockDurations() { return m_hostBlockDurations; }
+    std::vector<double>& getFinishDelays() { return m_finishDelays; }
+
+  private:
+    SessionBenchmark& m_owner;
+    const std::vector<int> m_instances;
+    const int m_numBlocks;
+    const Clock::time_point m_start;
+
+    juce::MidiBuffer m_midiMessages;
+    std::vector<double> m_processDurations;
+    std::vector<double> m_hostBlockDurations;
+    std::vector<double> m_finishDelays;
+};
+
+SessionBenchmark::SessionBenchmark(Settings settings)
+  : m_settings(std::move(settings))
+{
+}
+
+SessionBenchmark::~SessionBenchmark()
+{
+    for (auto& instance : m_instances) {
+        instance->releaseResources();
+    }
+}
+
+juce::Result SessionBenchmark::createSession()
+{
+    // the pool starts with the first instance prepared, and so with this many workers, as long as no earlier session
+    // still holds it
+    RealtimeWorkerPool::setDefaultNumWorkers(m_settings.numPoolWorkers);
+
+    const juce::int64 residentBytesBefore = getResidentBytes();
+
+    const auto instantiationStart = Clock::now();
+
+    for (int i = 0; i < m_settings.numInstances; ++i) {
+        m_instances.emplace_back(createPluginFilter());
+    }
+
+    const auto prepareStart = Clock::now();
+
+    for (auto& instance : m_instances) {
+        if (const auto error = this->applyParameters(*instance); error.isNotEmpty()) {
+            return juce::Result::fail(error);
+        }
+
+        if (auto* processor = dynamic_cast<PluginProcessor*>(instance.get())) {
+            processor->setUsesWorkerPool(m_settings.numPoolWorkers != 0);
+        }
+
+        instance->setPlayConfigDetails(m_settings.numChannels, m_settings.numChannels, m_settings.sampleRate, m_settings.blockSize);
+        instance->prepareToPlay(m_settings.sampleRate, m_settings.blockSize);
+    }
+
+    const auto prepareEnd = Clock::now();
+
+    m_instantiationSeconds = std::chrono::duration<double>(prepareStart - instantiationStart).count();
+    m_prepareSeconds = std::chrono::duration<double>(prepareEnd - prepareStart).count();
+
+    // includes each instance's share of whatever the instances share, such as the worker pool and FFT tables
+    const juce::int64 residentBytesAfter = getResidentBytes();
+
+    if (residentBytesBefore >= 0 && residentBytesAfter >= 0) {
+        m_residentBytes = residentBytesAfter - residentBytesBefore;
+    }
+
+    juce::Random random(1);
+    m_input.setSize(m_settings.numChannels, m_settings.blockSize);
+
+    for (int channel = 0; channel < m_input.getNumChannels(); ++channel) {
+        float* samples = m_input.getWritePointer(channel);
+
+        for (int i = 0; i < m_input.getNumSamples(); ++i) {
+            samples[i] = random.nextFloat() * 2.f - 1.f;
+        }
+    }
+
+    m_buffers.assign(m_instances.size(), juce::AudioBuffer<float>(m_settings.numChannels, m_settings.blockSize));
+
+    return juce::Result::ok();
+}
+
+juce::var SessionBenchmark::run(std::function<void(const juce::String&)> reportProgress)
+{
+    jassert(m_buffers.size() == m_instances.size() && !m_instances.empty());
+
+    auto report = [&reportProgress](const juce::String& text) {
+        if (reportProgress) {
+            reportProgress(text);
+        }
+    };
+
+    // off the clock, until every instance's input ring has filled and its output is live
+    report("warming up " + juce::String(static_cast<int>(m_instances.size())) + " instances");
+
+    juce::MidiBuffer midiMessages;
+
+    for (size_t instance = 0; instance < m_instances.size(); ++instance) {
+        const int numWarmUpSamples = 4 * juce::jmax(1, m_instances[instance]->getLatencySamples());
+
+        for (int numProcessed = 0; numProcessed < numWarmUpSamples; numProcessed += m_settings.blockSize) {
+            m_buffers[instance].makeCopyOf(m_input, true);
+            m_instances[instance]->processBlock(m_buffers[instance], midiMessages);
+        }
+    }
+
+    const int numHostThreads = juce::jlimit(1, static_cast<int>(m_instances.size()), m_settings.numHostThreads);
+    const int numBlocks = juce::jmax(1, static_cast<int>(m_settings.seconds * m_settings.sampleRate / m_settings.blockSize));
+
+    report("driving " + juce::String(static_cast<int>(m_instances.size())) + " instances from " + juce::String(numHostThreads) + " host threads for "
+           + juce::String(numBlocks) + " blocks");
+
+    // the instances are dealt out in turn, so every thread's share is within one of the others'
+    std::vector<std::vector<int>> shares(static_cast<size_t>(numHostThreads));
+
+    for (int instance = 0; instance < static_cast<int>(m_instances.size()); ++instance) {
+        shares[static_cast<size_t>(instance % numHostThreads)].push_back(instance);
+    }
+
+    // a little ahead, so that every thread is waiting when the first block is due
+    const auto start = Clock::now() + std::chrono::milliseconds(100);
+    std::vector<std::unique_ptr<HostThread>> hostThreads;
+
+    for (auto& share : shares) {
+        hostThreads.push_back(std::make_unique<HostThread>(*this, std::move(share), numBlocks, start));
+        hostThreads.back()->startRealtimeThread();
+    }
+
+    for (auto& hostThread : hostThreads) {
+        hostThread->waitForThreadToExit(-1);
+    }
+
+    // a host block is late if any thread finished its share of it more than the deadline after the block was due,
+    // which counts every block a thread spends catching up after an overrun, not only the one that overran
+    const double deadlineUs = this->getDeadlineMs() * 1000.0;
+    std::vector<double> processDurations;
+    std::vector<double> hostBlockDurations;
+    std::vector<double> lastFinishDelays(static_cast<size_t>(numBlocks), 0.0);
+
+    for (auto& hostThread : hostThreads) {
+        const auto& threadProcessDurations = hostThread->getProcessDurations();
+        const auto& threadHostBlockDurations = hostThread->getHostBlockDurations();
+        const auto& threadFinishDelays = hostThread->getFinishDelays();
+
+        processDurations.insert(processDurations.end(), threadProcessDurations.begin(), threadProcessDurations.end());
+        hostBlockDurations.insert(hostBlockDurations.end(), threadHostBlockDurations.begin(), threadHostBlockDurations.end());
+
+        for (size_t block = 0; block < threadFinishDelays.size(); ++block) {
+            lastFinishDelays[block] = juce::jmax(lastFinishDelays[block], threadFinishDelays[block]);
+        }
+    }
+
+    // how far past the deadline each late block finished
+    std::vector<double> latenesses;
+
+    for (const double finishDelay : lastFinishDelays) {
+        if (finishDelay > deadlineUs) {
+            latenesses.push_back(finishDelay - deadlineUs);
+        }
+    }
+
+    const auto numDeadlineMisses = latenesses.size();
+
+    double meanHostBlockUs = 0.0;
+
+    for (const double duration : hostBlockDurations) {
+        meanHostBlockUs += duration / static_cast<double>(hostBlockDurations.size());
+    }
+
+    const double numInstances = static_cast<double>(m_instances.size());
+    const juce::var processBlockUs = getPercentiles(processDurations);
+    const juce::var hostBlockUs = getPercentiles(hostBlockDurations);
+
+    auto* session = new juce::DynamicObject();
+    session->setProperty("numInstances", static_cast<int>(m_instances.size()));
+    session->setProperty("numHostThreads", numHostThreads);
+    session->setProperty("numPoolWorkers", m_settings.numPoolWorkers != 0 ? RealtimeWorkerPool::getDefaultNumWorkers() : 0);
+    session->setProperty("numChannels", m_settings.numChannels);
+    session->setProperty("blockSize", m_settings.blockSize);
+    session->setProperty("sampleRate", m_settings.sampleRate);
+    session->setProperty("deadlineMs", this->getDeadlineMs());
+    session->setProperty("latencySamples", m_instances.front()->getLatencySamples());
+
+    session->setProperty("instantiationMsPerInstance", m_instantiationSeconds * 1000.0 / numInstances);
+    session->setProperty("prepareMsPerInstance", m_prepareSeconds * 1000.0 / numInstances);
+    session->setProperty("residentBytesPerInstance", m_residentBytes >= 0 ? juce::var(static_cast<double>(m_residentBytes) / numInstances) : juce::var());
+
+    session->setProperty("numHostBlocks", numBlocks);
+    session->setProperty("numDeadlineMisses", static_cast<int>(numDeadlineMisses));
+    session->setProperty("deadlineMissRate", static_cast<double>(numDeadlineMisses) / numBlocks);
+    session->setProperty("latenessUs", getPercentiles(latenesses));
+    session->setProperty("processBlockUs", processBlockUs);
+    session->setProperty("hostBlockUs", hostBlockUs);
+
+    // the share of each deadline a host thread spends processing, and how many instances would fit if that scaled
+    // linearly up to the slowest blocks filling the deadline
+    session->setProperty("load", meanHostBlockUs / deadlineUs);
+    session->setProperty("estimatedInstanceCapacity", numInstances * deadlineUs / juce::jmax(1.0, static_cast<double>(hostBlockUs["p999"])));
+
+    auto* benchmark = new juce::DynamicObject();
+    benchmark->setProperty("build", EngineBenchmarks::getBuildDetails());
+    benchmark->setProperty("session", session);
+
+    return benchmark;
+}
+
+// returns an error for an unknown parameter
+juce::String SessionBenchmark::applyParameters(juce::AudioProcessor& processor) const
+{
+    const auto& parameterIDs = m_settings.parameters.getAllKeys();
+
+    for (const auto& parameterID : parameterIDs) {
+        juce::AudioProcessorParameter* parameter = nullptr;
+
+        for (auto* candidate : processor.getParameters()) {
+            if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(candidate); withID != nullptr && withID->paramID == parameterID) {
+                parameter = candidate;
+            }
+        }
+
+        if (parameter == nullptr) {
+            return "unknown parameter " + parameterID;
+        }
+
+        parameter->setValueNotifyingHost(parameter->getValueForText(m_settings.parameters[parameterID]));
+    }
+
+    return {};
+}
+
+double SessionBenchmark::getDeadlineMs() const
+{
+    return m_settings.deadlineMs > 0.0 ? m_settings.deadlineMs : m_settings.blockSize * 1000.0 / m_settings.sampleRate;
+}
+
+juce::int64 SessionBenchmark::getResidentBytes()
+{
+#if JUCE_LINUX
+    // the second field is the resident set, in pages
+    const auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), " ", "");
+
+    if (fields.size() >= 2) {
+        return fields[1].getLargeIntValue() * static_cast<juce::int64>(sysconf(_SC_PAGESIZE));
+    }
+#elif JUCE_MAC
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+        return static_cast<juce::int64>(info.resident_size);
+    }
+#endif
+
+    return -1;
+}
+
+// sorts durations in place and summarises them
+juce::var SessionBenchmark::getPercentiles(std::vector<double>& durations)
+{
+    if (durations.empty()) {
+        return {};
+    }
+
+    std::sort(durations.begin(), durations.end());
+
+    auto getPercentile = [&durations](size_t perMille) { return durations[juce::jmin(durations.size() - 1, durations.size() * perMille / 1000)]; };
+
+    double mean = 0.0;
+
+    for (const double duration : durations) {
+        mean += duration / static_cast<double>(durations.size());
+    }
+
+    auto* percentiles = new juce::DynamicObject();
+    percentiles->setProperty("mean", mean);
+    percentiles->setProperty("p50", getPercentile(500));
+    percentiles->setProperty("p99", getPercentile(990));
+    percentiles->setProperty("p999", getPercentile(999));
+    percentiles->setProperty("max", durations.back());
+
+    return percentiles;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// a headless fake host for measuring how many instances fit in one process: it creates and prepares a session's worth
+// of plugins the way a host would, then drives them from a number of host threads, each owning an equal share of the
+// instances and processing its share once per host block, paced in real time
+//
+// a host block misses its deadline when a thread finishes its share more than the deadline after the block was due, so
+// a thread that overruns keeps missing until it has caught up; how late the late blocks were is reported alongside.
+// the results are reported as JSON, like the engine benchmarks
+class SessionBenchmark
+{
+  public:
+    struct Settings
+    {
+        // parameter IDs and values as text, e.g. { "fftSize", "2048" }, applied to every instance
+        juce::StringPairArray parameters;
+
+        int numInstances = 100;
+        int numHostThreads = juce::SystemStats::getNumCpus();
+        // workers in the shared pool the instances start; zero keeps them out of it, negative is the pool's own default
+        int numPoolWorkers = -1;
+        int numChannels = 2;
+        int blockSize = 512;
+        double sampleRate = 48000.0;
+
+        // how long after a block is due a host thread may finish its share of it; zero is the block's own duration
+        double deadlineMs = 0.0;
+        // how long the session is driven for, after warming up
+        double seconds = 10.0;
+    };
+
+    explicit SessionBenchmark(Settings settings);
+    ~SessionBenchmark();
+
+    // creates and prepares every instance, timing both and measuring the memory they take; fails on an unknown parameter
+    juce::Result createSession();
+
+    // drives the session and returns an object with the build's details under "build" and the measurements under
+    // "session"; call createSession() first
+    juce::var run(std::function<void(const juce::String&)> reportProgress = {});
+
+  private:
+    class HostThread;
+
+    const Settings m_settings;
+
+    std::vector<std::unique_ptr<juce::AudioProcessor>> m_instances;
+    std::vector<juce::AudioBuffer<float>> m_buffers;
+    juce::AudioBuffer<float> m_input;
+
+    double m_instantiationSeconds = 0.0;
+    double m_prepareSeconds = 0.0;
+    // negative where the platform gives no figure
+    juce::int64 m_residentBytes = -1;
+
+    juce::String applyParameters(juce::AudioProcessor& processor) const;
+    double getDeadlineMs() const;
+
+    static juce::int64 getResidentBytes();
+    static juce::var getPercentiles(std::vector<double>& durations);
+};
@@ -1,33 +1,51 @@
-#ifndef CIRCULAR_BUFFER_H
-#define CIRCULAR_BUFFER_H
-
-#include <mutex>
-#include <vector>
-
-template<typename SampleType>
-class CircularBuffer
-{
-  public:
-    CircularBuffer();
-    CircularBuffer(uint32_t size);
-
-    SampleType getSample(uint32_t index);
-
-    void write(const SampleType& value);
-    void resize(uint32_t size);
-    void copyTo(std::vector<SampleType>& destination);
-
-    bool isFilled();
-
-  private:
-    std::vector<SampleType> m_buffer;
-
-    unsigned int m_writeIndex = 0;
-    bool m_isFilled = false;
-
-    std::mutex m_readWriteLock;
-};
-
-#include "CircularBuffer.tcc"
-
-#endif
+#ifndef CIRCULAR_BUFFER_H
+#define CIRCULAR_BUFFER_H
+
+#include <atomic>
+#include <type_traits>
+#include <vector>
+
+// single-producer ring of the most recent samples; the producer never waits, and readers take snapshots that are
+// validated against a sequence counter instead of locking
+template<typename SampleType>
+class CircularBuffer
+{
+    static_assert(std::is_trivially_copyable<SampleType>::value, "snapshots are taken with memcpy");
+
+  public:
+    CircularBuffer();
+    CircularBuffer(uint32_t size);
+
+    SampleType getSample(uint32_t index);
+
+    // producer side; a whole block costs one publication
+    void write(const SampleType& value);
+    void write(const SampleType* values, uint32_t num);
+
+    // not safe against a concurrent producer; call before it starts
+    void resize(uint32_t size);
+
+    // copies the ring oldest sample first; returns false if the producer kept overwriting it and no consistent
+    // snapshot could be taken, in which case the caller just tries again later
+    bool copyTo(std::vector<SampleType>& destination);
+
+    bool isFilled();
+
+  private:
+    enum
+    {
+        MAX_SNAPSHOT_ATTEMPTS = 4,
+    };
+
+    std::vector<SampleType> m_buffer;
+
+    std::atomic<uint32_t> m_writeIndex = 0;
+    std::atomic<bool> m_isFilled = false;
+
+    // odd while the producer is writing
+    std::atomic<uint32_t> m_sequence = 0;
+};
+
+#include "CircularBuffer.tcc"
+
+#endif
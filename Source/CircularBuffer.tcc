@@ -1,72 +1,118 @@
-#include <cassert>
-
-template<typename SampleType>
-CircularBuffer<SampleType>::CircularBuffer()
-  : m_buffer(0)
-{
-}
-
-template<typename SampleType>
-CircularBuffer<SampleType>::CircularBuffer(uint32_t size)
-  : m_buffer(size)
-{
-}
-
-template<typename SampleType>
-SampleType CircularBuffer<SampleType>::getSample(uint32_t index)
-{
-    m_readWriteLock.lock();
-    SampleType sample = m_buffer[index];
-    m_readWriteLock.unlock();
-
-    return sample;
-}
-
-template<typename SampleType>
-void CircularBuffer<SampleType>::write(const SampleType& value)
-{
-    m_readWriteLock.lock();
-
-    m_buffer[m_writeIndex] = value;
-
-    if (m_writeIndex == m_buffer.size() - 1) {
-        m_isFilled = true;
-    }
-
-    m_writeIndex = (m_writeIndex + 1) % static_cast<uint32_t>(m_buffer.size());
-
-    m_readWriteLock.unlock();
-}
-
-template<typename SampleType>
-void CircularBuffer<SampleType>::resize(uint32_t size)
-{
-    m_readWriteLock.lock();
-
-    m_buffer.clear();
-    m_buffer.resize(size);
-    m_writeIndex = 0;
-    m_isFilled = false;
-
-    m_readWriteLock.unlock();
-}
-
-template<typename SampleType>
-void CircularBuffer<SampleType>::copyTo(std::vector<SampleType>& destination)
-{
-    assert(destination.size() == m_buffer.size());
-
-    m_readWriteLock.lock();
-    memcpy(&destination[0], &m_buffer[0], sizeof(SampleType) * m_buffer.size());
-    m_readWriteLock.unlock();
-}
-
-template<typename SampleType>
-bool CircularBuffer<SampleType>::isFilled()
-{
-    m_readWriteLock.lock();
-    bool isFilled = m_isFilled;
-    m_readWriteLock.unlock();
-
-    return isFilled;
-}
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+template<typename SampleType>
+CircularBuffer<SampleType>::CircularBuffer()
+  : m_buffer(0)
+{
+}
+
+template<typename SampleType>
+CircularBuffer<SampleType>::CircularBuffer(uint32_t size)
+  : m_buffer(size)
+{
+}
+
+template<typename SampleType>
+SampleType CircularBuffer<SampleType>::getSample(uint32_t index)
+{
+    SampleType sample;
+
+    do {
+        const uint32_t sequence = m_sequence.load(std::memory_order_acquire);
+        sample = m_buffer[index];
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if ((sequence & 1) == 0 && m_sequence.load(std::memory_order_relaxed) == sequence) {
+            break;
+        }
+    } while (true);
+
+    return sample;
+}
+
+template<typename SampleType>
+void CircularBuffer<SampleType>::write(const SampleType& value)
+{
+    this->write(&value, 1);
+}
+
+template<typename SampleType>
+void CircularBuffer<SampleType>::write(const SampleType* values, uint32_t num)
+{
+    const uint32_t size = static_cast<uint32_t>(m_buffer.size());
+
+    if (size == 0) {
+        return;
+    }
+
+    uint32_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+
+    // only the last size samples of a longer block survive, so the rest are skipped rather than written over
+    if (num > size) {
+        writeIndex = (writeIndex + (num - size)) % size;
+        values += num - size;
+        num = size;
+    }
+
+    const uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const uint32_t numBeforeWrap = std::min(num, size - writeIndex);
+    memcpy(m_buffer.data() + writeIndex, values, sizeof(SampleType) * numBeforeWrap);
+    memcpy(m_buffer.data(), values + numBeforeWrap, sizeof(SampleType) * (num - numBeforeWrap));
+
+    if (writeIndex + num >= size) {
+        m_isFilled.store(true, std::memory_order_relaxed);
+    }
+
+    m_writeIndex.store((writeIndex + num) % size, std::memory_order_relaxed);
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+template<typename SampleType>
+void CircularBuffer<SampleType>::resize(uint32_t size)
+{
+    m_buffer.clear();
+    m_buffer.resize(size);
+    m_writeIndex = 0;
+    m_isFilled = false;
+}
+
+template<typename SampleType>
+bool CircularBuffer<SampleType>::copyTo(std::vector<SampleType>& destination)
+{
+    assert(destination.size() == m_buffer.size());
+
+    const uint32_t size = static_cast<uint32_t>(m_buffer.size());
+
+    for (int attempt = 0; attempt < MAX_SNAPSHOT_ATTEMPTS; ++attempt) {
+        const uint32_t sequence = m_sequence.load(std::memory_order_acquire);
+
+        if ((sequence & 1) != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const uint32_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+        memcpy(destination.data(), m_buffer.data() + writeIndex, sizeof(SampleType) * (size - writeIndex));
+        memcpy(destination.data() + (size - writeIndex), m_buffer.data(), sizeof(SampleType) * writeIndex);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (m_sequence.load(std::memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template<typename SampleType>
+bool CircularBuffer<SampleType>::isFilled()
+{
+    return m_isFilled.load(std::memory_order_relaxed);
+}
@@ -1,46 +1,102 @@
-#pragma once
-
-#include <JuceHeader.h>
-
-class FFTBuffer
-{
-  public:
-    FFTBuffer(unsigned numChannels,
-              unsigned size,
-              unsigned fftSize,
-              unsigned windowSize,
-              unsigned numOverlaps,
-              std::function<void(std::complex<float>*, unsigned int)> processFFT);
-    ~FFTBuffer() = default;
-
-    void write(unsigned channel, float sample);
-    float readResult(unsigned channel);
-    unsigned getWritePos(unsigned channel);
-
-  private:
-    juce::AudioBuffer<float> m_inputAudio;
-    std::vector<juce::AudioBuffer<juce::dsp::Complex<float>>> m_outputAudioFrames;
-    juce::AudioBuffer<std::complex<float>> mResultBuffer;
-    std::vector<std::atomic<long unsigned>> mReadPos, mWritePos;
-    std::vector<std::atomic<long unsigned>> mResultReadPos;
-    juce::dsp::FFT mFFT;
-    juce::dsp::WindowingFunction<float> mWindow;
-
-    std::vector<unsigned> mFrameIndex;
-
-    std::vector<std::queue<float>> mResults;
-
-    std::function<void(std::complex<float>*, unsigned int)> mProcessFFT;
-
-    std::atomic<bool> m_minSamplesReached = false;
-
-    unsigned int m_size;
-    unsigned int m_sizeWindow;
-    unsigned int m_sizeOverlaps;
-    unsigned int m_numOverlaps;
-
-    unsigned int getThenIncrementWrite(unsigned channel, unsigned num = 1);
-    unsigned int getThenIncrementRead(unsigned channel, unsigned num = 1);
-    unsigned int getThenIncrementReadResult(unsigned channel, unsigned num = 1);
-    void performFFT(const unsigned channel);
-};
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "FFTEngine.h"
+#include "RealtimeWorkerPool.h"
+
+// processFFT receives the fftSize / 2 + 1 non-negative frequency bins of each frame;
+// the negative frequencies are implied by conjugate symmetry
+class FFTBuffer
+{
+  public:
+    using Scheduling = FFTScheduling;
+
+    // the orders and overlaps an engine is instantiated for; anything else asserts
+    static constexpr unsigned minFFTOrder = 8;
+    static constexpr unsigned maxFFTOrder = 14;
+
+    // a single channel leaves nothing to hand to a worker pool
+    static constexpr unsigned minParallelChannels = 2;
+
+    FFTBuffer(unsigned numChannels,
+              unsigned size,
+              unsigned fftOrder,
+              unsigned windowSize,
+              unsigned numOverlaps,
+              std::function<void(std::complex<float>*, unsigned int)> processFFT);
+
+    // takes the spectral processor by type, so the engine calls it directly rather than through std::function
+    template<typename Processor>
+    FFTBuffer(unsigned numChannels, unsigned fftOrder, unsigned numOverlaps, Processor processor);
+
+    // runs a block through the engine; input and output may alias for in-place processing
+    void process(const float* input, float* output, int numSamples, unsigned channel);
+
+    // runs a block of every channel; a stereo engine packs its channels into one transform, which only this keeps up,
+    // so the first per-channel process() or write() makes it transform each channel on its own from then on; output
+    // is the same either way to within rounding
+    void process(const float* const* input, float* const* output, int numSamples);
+
+    // lets process() spread the channels of each block that transforms across the pool, unpacking a stereo engine to do
+    // so, or the frames of a batch whatever the channel count; the pool must outlive this
+    void setWorkerPool(RealtimeWorkerPool* workerPool);
+
+    unsigned getNumChannels() const;
+
+    void write(unsigned channel, float sample);
+    float readResult(unsigned channel);
+    unsigned getWritePos(unsigned channel);
+
+    void clear();
+
+    // starts whatever a scheduling mode needs, such as the worker thread; call off the audio thread
+    void prepareScheduling(Scheduling scheduling);
+    bool isSchedulingPrepared(Scheduling scheduling) const;
+
+    // switches modes between blocks without allocating; the streaming state is cleared
+    void setScheduling(Scheduling scheduling);
+    Scheduling getScheduling() const;
+
+    unsigned getLatencySamples() const;
+
+  private:
+    const unsigned m_numChannels;
+    std::unique_ptr<FFTEngineBase> m_engine;
+    RealtimeWorkerPool* m_workerPool = nullptr;
+
+    template<unsigned Order, typename Processor>
+    static std::unique_ptr<FFTEngineBase> createEngine(unsigned numChannels, unsigned fftOrder, unsigned numOverlaps, Processor& processor);
+};
+
+template<typename Processor>
+FFTBuffer::FFTBuffer(unsigned numChannels, unsigned fftOrder, unsigned numOverlaps, Processor processor)
+  : m_numChannels(numChannels)
+  , m_engine(createEngine<minFFTOrder>(numChannels, fftOrder, numOverlaps, processor))
+{
+}
+
+template<unsigned Order, typename Processor>
+std::unique_ptr<FFTEngineBase> FFTBuffer::createEngine(unsigned numChannels, unsigned fftOrder, unsigned numOverlaps, Processor& processor)
+{
+    if constexpr (Order > maxFFTOrder) {
+        jassertfalse;
+        return nullptr;
+    } else {
+        if (fftOrder != Order) {
+            return createEngine<Order + 1>(numChannels, fftOrder, numOverlaps, processor);
+        }
+
+        switch (numOverlaps) {
+            case 2:
+                return std::make_unique<FFTEngine<Order, 2, Processor>>(numChannels, std::move(processor));
+            case 4:
+                return std::make_unique<FFTEngine<Order, 4, Processor>>(numChannels, std::move(processor));
+            case 8:
+                return std::make_unique<FFTEngine<Order, 8, Processor>>(numChannels, std::move(processor));
+            default:
+                jassertfalse;
+                return nullptr;
+        }
+    }
+}
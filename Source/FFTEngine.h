@@ -0,0 +1,226 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "FFTTableCache.h"
+#include "RealtimeWorkerPool.h"
+
+enum class FFTScheduling
+{
+    // each hop is processed inside the process() call that completes it
+    immediate,
+    // hops are handed to a dedicated worker thread and collected one hop later
+    worker,
+    // each hop's stages are spread over the process() calls of the following hop
+    amortized,
+    // the hops of a block are transformed together, their frames spread over the worker pool; for offline rendering,
+    // where blocks are large, and with the same latency and output as immediate
+    batched,
+};
+
+// the runtime interface FFTBuffer dispatches through; one virtual call per block rather than per sample
+class FFTEngineBase
+{
+  public:
+    virtual ~FFTEngineBase() = default;
+
+    virtual void process(const float* input, float* output, int numSamples, unsigned channel) = 0;
+    virtual void process(const float* const* input, float* const* output, int numSamples) = 0;
+
+    virtual void write(unsigned channel, float sample) = 0;
+    virtual float readResult(unsigned channel) = 0;
+    virtual unsigned getWritePos(unsigned channel) const = 0;
+
+    virtual void clear() = 0;
+
+    virtual void prepareScheduling(FFTScheduling scheduling) = 0;
+    virtual bool isSchedulingPrepared(FFTScheduling scheduling) const = 0;
+    virtual void setScheduling(FFTScheduling scheduling) = 0;
+    virtual FFTScheduling getScheduling() const = 0;
+
+    virtual void setWorkerPool(RealtimeWorkerPool* workerPool) = 0;
+
+    // whether a multi-channel block of numSamples has transform work in it: it completes a frame or, when amortized,
+    // runs one of a frame's stages; any other block only copies samples in and out
+    virtual bool hasFrameWork(int numSamples) const = 0;
+
+    // makes a packed stereo engine transform each channel on its own from here on, so that the channels can be processed
+    // on different threads; called on the thread that drives the engine
+    virtual void unpackChannels() = 0;
+
+    virtual unsigned getLatencySamples() const = 0;
+};
+
+// an STFT engine whose geometry is fixed at compile time, so ring positions wrap with masks and the spectral
+// processor is called directly; Processor is invoked as processor(std::complex<float>* bins, unsigned channel)
+// with the fftSize / 2 + 1 non-negative frequency bins of each frame
+//
+// a single channel runs as a real transform of fftSize points built on a complex one of half that size, whose
+// spectrum is split into the even and odd samples' spectra and recombined with a table of twiddles; JUCE's own
+// real-only transforms do this only with FFTW or vDSP and otherwise run a full size complex transform
+//
+// a two-channel engine packs the left channel into the real part and the right into the imaginary part of a single
+// complex transform each way, halving the transform count; that keeps the channels in lockstep, so the first
+// per-channel process() or write() unpacks them for good and each channel runs its own real transform from then on
+//
+// a batched engine batches only in the multi-channel process(), which also keeps the channels in lockstep; the
+// per-channel calls run as immediate
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+class FFTEngine final : public FFTEngineBase
+{
+  public:
+    static constexpr unsigned windowSize = 1u << Order;
+    static constexpr unsigned inputSize = 2 * windowSize;
+    static constexpr unsigned hopSize = windowSize / NumOverlaps;
+
+    static_assert((NumOverlaps & (NumOverlaps - 1)) == 0 && NumOverlaps >= 2 && NumOverlaps <= windowSize, "overlap must be a power of two");
+
+    FFTEngine(unsigned numChannels, Processor processor);
+    ~FFTEngine() override;
+
+    // runs a block through the engine; input and output may alias for in-place processing
+    void process(const float* input, float* output, int numSamples, unsigned channel) override;
+
+    // runs a block of every channel through the engine, hop by hop across the channels, or batch by batch when batched
+    void process(const float* const* input, float* const* output, int numSamples) override;
+
+    void write(unsigned channel, float sample) override;
+    float readResult(unsigned channel) override;
+    unsigned getWritePos(unsigned channel) const override;
+
+    // resets all streaming state without touching the allocator
+    void clear() override;
+
+    // starts whatever a scheduling mode needs, such as the worker thread; call off the audio thread
+    void prepareScheduling(FFTScheduling scheduling) override;
+    bool isSchedulingPrepared(FFTScheduling scheduling) const override;
+
+    // switches modes between blocks without allocating; the streaming state is cleared
+    void setScheduling(FFTScheduling scheduling) override;
+    FFTScheduling getScheduling() const override;
+
+    // where batched frames are spread; without one they run on the calling thread. the pool must outlive this
+    void setWorkerPool(RealtimeWorkerPool* workerPool) override;
+
+    bool hasFrameWork(int numSamples) const override;
+    void unpackChannels() override;
+
+    unsigned getLatencySamples() const override;
+
+  private:
+    class Worker;
+
+    static constexpr unsigned inputMask = inputSize - 1;
+    static constexpr unsigned windowMask = windowSize - 1;
+    static constexpr unsigned hopMask = hopSize - 1;
+
+    // a frame's stages in the order they run; stageComplete means nothing is pending
+    enum FrameStage
+    {
+        stageGather,
+        stageForward,
+        stageProcess,
+        stageInverse,
+        stageOverlapAdd,
+        stageComplete,
+    };
+
+    enum FrameState
+    {
+        frameIdle,
+        frameQueued,
+        frameRunning,
+        frameDone,
+    };
+
+    juce::AudioBuffer<float> m_inputAudio;
+    // one window of running overlap-add per channel, addressed as a ring that advances a hop per frame
+    juce::AudioBuffer<float> m_overlapAccumulator;
+    juce::AudioBuffer<float> mResultBuffer;
+    juce::AudioBuffer<float> m_fftWorkspace;
+    std::vector<unsigned> mWritePos;
+    std::vector<unsigned> mResultReadPos, mResultWritePos;
+    std::vector<unsigned> mAccumulatorPos;
+    // the plans and window are shared with every other engine of the same geometry, and kept alive by the cache while
+    // any engine exists so that the next one finds them; each channel has a half size plan of its own, which is a
+    // separate one unless the cache shares plans, since JUCE's fallback FFT locks each plan while it transforms
+    juce::SharedResourcePointer<FFTTableCache> m_tableCache;
+    std::shared_ptr<const juce::dsp::FFT> mFFT;
+    std::vector<std::shared_ptr<const juce::dsp::FFT>> m_halfFFTs;
+    std::shared_ptr<const std::vector<std::complex<float>>> m_realTwiddles;
+    std::shared_ptr<const std::vector<float>> m_windowTable;
+
+    // with two channels, a frame runs both through one complex transform; the frame is then driven from channel 0
+    bool m_isStereoPacked;
+    std::vector<std::complex<float>> m_packedSignal;
+    std::vector<std::complex<float>> m_packedSpectrum;
+
+    std::vector<unsigned> mNumResults;
+
+    Processor m_processor;
+
+    // one flag per channel, since channels running on different threads fill their rings at their own pace, and one that
+    // saw another's flag set could transform a frame before its own input is complete; lockstep modes read channel 0's
+    std::vector<char> m_minSamplesReached;
+
+    FFTScheduling m_scheduling = FFTScheduling::immediate;
+    // created by prepareScheduling(), so only engines that run in worker mode have the thread
+    std::unique_ptr<Worker> m_worker;
+    std::vector<std::atomic<int>> mFrameStates;
+    std::vector<int> mFrameStages;
+    juce::AbstractFifo m_jobFifo;
+    std::vector<unsigned> m_jobQueue;
+
+    // a batch covers at most a window, so it completes at most one frame per overlap; each frame has a workspace slot of
+    // its own, allocated by prepareScheduling() since only batched engines need them
+    RealtimeWorkerPool* m_workerPool = nullptr;
+    juce::AudioBuffer<float> m_batchWorkspace;
+    std::vector<std::complex<float>> m_batchPackedSignal;
+    std::vector<std::complex<float>> m_batchPackedSpectrum;
+    std::atomic<bool> m_isBatchPrepared = false;
+    std::vector<unsigned> m_batchFrameEnds;
+
+    unsigned int getThenIncrementWrite(unsigned channel, unsigned num = 1);
+    unsigned int getThenIncrementReadResult(unsigned channel, unsigned num = 1);
+    unsigned int getThenIncrementWriteResult(unsigned channel, unsigned num = 1);
+    void writeChunk(unsigned channel, const float* input, unsigned num);
+    void readResults(unsigned channel, float* output, unsigned num);
+    void advanceHop(unsigned channel);
+    void performFFT(const unsigned channel);
+    unsigned getFrameEnd(unsigned channel) const;
+
+    // slot 0 is the streaming workspace and batch frames take the slots after it
+    float* getFrameData(unsigned channel, unsigned slot);
+    std::complex<float>* getPackedSignal(unsigned slot);
+    std::complex<float>* getPackedSpectrum(unsigned slot);
+
+    void gatherFrame(unsigned channel, unsigned frameEnd, unsigned slot = 0);
+    void gatherChannel(unsigned channel, unsigned frameEnd, unsigned slot);
+    void forwardTransformFrame(unsigned channel, unsigned slot = 0);
+    void processFrame(unsigned channel, unsigned slot = 0);
+    void inverseTransformFrame(unsigned channel, unsigned slot = 0);
+    void forwardTransformReal(unsigned channel, float* fftData);
+    void inverseTransformReal(unsigned channel, float* fftData);
+    void forwardTransformPair(unsigned slot);
+    void inverseTransformPair(unsigned slot);
+    void transformFrame(unsigned channel);
+    void overlapAddFrame(unsigned channel, unsigned slot = 0);
+    void overlapAddChannel(unsigned channel, unsigned slot);
+    void runFrameStage(unsigned channel, int stage);
+    void advanceFrame(unsigned channel, int targetStage);
+    int getDueStage(unsigned hopPosition) const;
+    void submitFrame(unsigned channel);
+    void collectFrame(unsigned channel);
+    bool runQueuedFrame(unsigned channel);
+    void runQueuedFrames();
+    void settleFrames();
+
+    void processBatches(const float* const* input, float* const* output, int numSamples);
+    unsigned writeBatch(const float* const* input, unsigned offset, unsigned numSamples);
+    void readBatch(unsigned channel, float* const* output, unsigned offset, unsigned batchStart, unsigned numSamples, unsigned numFrames);
+
+    template<typename Function>
+    void runBatchJobs(int numJobs, Function& function);
+};
+
+#include "FFTEngine.tcc"
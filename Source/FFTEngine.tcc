@@ -0,0 +1,897 @@
+#include "ScopedNoAllocation.h"
+#include "SpectralKernels.h"
+#include "WakeUpSignal.h"
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+class FFTEngine<Order, NumOverlaps, Processor>::Worker : public juce::Thread
+{
+  public:
+    Worker(FFTEngine& owner)
+      : juce::Thread("FFTEngine worker")
+      , m_owner(owner)
+    {
+    }
+
+    ~Worker() override
+    {
+        this->signalThreadShouldExit();
+        m_wakeUp.signal();
+        this->stopThread(1000);
+    }
+
+    // called on the audio thread, so it takes no lock
+    void wakeUp() { m_wakeUp.signal(); }
+
+    void run() override
+    {
+        // a frame submitted while the queue is being run wakes the next wait straight away
+        while (!this->threadShouldExit()) {
+            m_wakeUp.reset();
+            m_owner.runQueuedFrames();
+            m_wakeUp.wait(100);
+        }
+    }
+
+  private:
+    FFTEngine& m_owner;
+    WakeUpSignal m_wakeUp;
+};
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+FFTEngine<Order, NumOverlaps, Processor>::FFTEngine(unsigned numChannels, Processor processor)
+  : m_inputAudio(static_cast<int>(numChannels), static_cast<int>(inputSize))
+  , m_overlapAccumulator(static_cast<int>(numChannels), static_cast<int>(windowSize))
+  , mResultBuffer(static_cast<int>(numChannels), static_cast<int>(windowSize))
+  , m_fftWorkspace(static_cast<int>(numChannels), static_cast<int>(2 * windowSize))
+  , mWritePos(numChannels)
+  , mResultReadPos(numChannels)
+  , mResultWritePos(numChannels)
+  , mAccumulatorPos(numChannels)
+  , mFFT(m_tableCache->getPlan(Order))
+  , m_realTwiddles(m_tableCache->getRealTwiddles(windowSize))
+  , m_windowTable(m_tableCache->getSynthesisWindow(juce::dsp::WindowingFunction<float>::hann, windowSize, NumOverlaps))
+  , m_isStereoPacked(numChannels == 2)
+  , m_packedSignal(m_isStereoPacked ? windowSize : 0)
+  , m_packedSpectrum(m_isStereoPacked ? windowSize : 0)
+  , mNumResults(numChannels)
+  , m_processor(std::move(processor))
+  , m_minSamplesReached(numChannels)
+  , mFrameStates(numChannels)
+  , mFrameStages(numChannels)
+  , m_jobFifo(static_cast<int>(numChannels) + 1)
+  , m_jobQueue(numChannels + 1)
+  , m_batchFrameEnds(NumOverlaps)
+{
+    for (unsigned channel = 0; channel < numChannels; ++channel) {
+        m_halfFFTs.push_back(m_tableCache->getPlan(Order - 1));
+    }
+
+    for (auto& frameState : mFrameStates) {
+        frameState = frameIdle;
+    }
+
+    this->clear();
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+FFTEngine<Order, NumOverlaps, Processor>::~FFTEngine()
+{
+    // joins the worker before any state it might touch goes away
+    m_worker.reset();
+}
+
+// resets all streaming state without touching the allocator; every buffer is sized once in the constructor
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::clear()
+{
+    this->settleFrames();
+
+    m_inputAudio.clear();
+    m_overlapAccumulator.clear();
+    mResultBuffer.clear();
+    m_fftWorkspace.clear();
+
+    for (unsigned channel = 0; channel < mNumResults.size(); ++channel) {
+        mWritePos[channel] = 0;
+        mResultReadPos[channel] = 0;
+        mResultWritePos[channel] = 0;
+        mAccumulatorPos[channel] = 0;
+        mNumResults[channel] = 0;
+        mFrameStages[channel] = stageComplete;
+    }
+
+    std::fill(m_minSamplesReached.begin(), m_minSamplesReached.end(), false);
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::prepareScheduling(FFTScheduling scheduling)
+{
+    // only engines that are going to use it get a worker thread
+    if (scheduling == FFTScheduling::worker && m_worker == nullptr) {
+        m_worker = std::make_unique<Worker>(*this);
+        m_worker->startRealtimeThread();
+    }
+
+    if (scheduling == FFTScheduling::batched && !m_isBatchPrepared) {
+        const unsigned numChannels = static_cast<unsigned>(mNumResults.size());
+        m_batchWorkspace.setSize(static_cast<int>(NumOverlaps * numChannels), static_cast<int>(2 * windowSize));
+
+        if (m_isStereoPacked) {
+            m_batchPackedSignal.resize(NumOverlaps * windowSize);
+            m_batchPackedSpectrum.resize(NumOverlaps * windowSize);
+        }
+
+        m_isBatchPrepared = true;
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+bool FFTEngine<Order, NumOverlaps, Processor>::isSchedulingPrepared(FFTScheduling scheduling) const
+{
+    switch (scheduling) {
+        case FFTScheduling::worker:
+            return m_worker != nullptr && m_worker->isThreadRunning();
+        case FFTScheduling::batched:
+            return m_isBatchPrepared;
+        default:
+            return true;
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::setScheduling(FFTScheduling scheduling)
+{
+    jassert(this->isSchedulingPrepared(scheduling));
+
+    if (scheduling == m_scheduling) {
+        return;
+    }
+
+    // frames in flight belong to the old timeline, so they are dropped with the rest of the stream
+    this->clear();
+    m_scheduling = scheduling;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+FFTScheduling FFTEngine<Order, NumOverlaps, Processor>::getScheduling() const
+{
+    return m_scheduling;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::setWorkerPool(RealtimeWorkerPool* workerPool)
+{
+    m_workerPool = workerPool;
+}
+
+// the channels are in lockstep whenever a multi-channel block starts, so channel 0 stands for all of them; the first
+// frames, before the input ring has filled, are counted as if they were complete, which only costs a wasted fan-out
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+bool FFTEngine<Order, NumOverlaps, Processor>::hasFrameWork(int numSamples) const
+{
+    // amortized stages fall due at every quarter of the hop
+    const unsigned stepSize = m_scheduling == FFTScheduling::amortized ? hopSize / 4 : hopSize;
+    return (mWritePos[0] & (stepSize - 1)) + static_cast<unsigned>(numSamples) >= stepSize;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+unsigned FFTEngine<Order, NumOverlaps, Processor>::getLatencySamples() const
+{
+    // deferred modes deliver each frame one hop after its input is complete
+    const bool isDeferred = m_scheduling == FFTScheduling::worker || m_scheduling == FFTScheduling::amortized;
+    return windowSize + (isDeferred ? hopSize : 0);
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::process(const float* input, float* output, int numSamples, unsigned channel)
+{
+    const ScopedNoAllocation noAllocation;
+
+    // a packed frame needs both channels' input, so channels that advance one at a time are transformed apart
+    this->unpackChannels();
+
+    unsigned offset = 0;
+    unsigned numRemaining = static_cast<unsigned>(numSamples);
+
+    while (numRemaining > 0) {
+        // stop each chunk at the next hop boundary so a frame is processed at most once per chunk
+        const unsigned numToBoundary = hopSize - (mWritePos[channel] & hopMask);
+        const unsigned numChunk = juce::jmin(numRemaining, numToBoundary);
+
+        // results are read before the chunk's hop is processed, matching the per-sample read-then-write
+        // order; the input is consumed first so that output may alias it
+        this->writeChunk(channel, input + offset, numChunk);
+        this->readResults(channel, output + offset, numChunk);
+        this->advanceHop(channel);
+
+        offset += numChunk;
+        numRemaining -= numChunk;
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::process(const float* const* input, float* const* output, int numSamples)
+{
+    const unsigned numChannels = static_cast<unsigned>(mNumResults.size());
+
+    if (m_scheduling == FFTScheduling::batched) {
+        this->processBatches(input, output, numSamples);
+        return;
+    }
+
+    if (!m_isStereoPacked) {
+        for (unsigned channel = 0; channel < numChannels; ++channel) {
+            this->process(input[channel], output[channel], numSamples, channel);
+        }
+
+        return;
+    }
+
+    const ScopedNoAllocation noAllocation;
+
+    unsigned offset = 0;
+    unsigned numRemaining = static_cast<unsigned>(numSamples);
+
+    while (numRemaining > 0) {
+        // the channels move in lockstep, so channel 0's position stands for both
+        const unsigned numToBoundary = hopSize - (mWritePos[0] & hopMask);
+        const unsigned numChunk = juce::jmin(numRemaining, numToBoundary);
+
+        for (unsigned channel = 0; channel < numChannels; ++channel) {
+            this->writeChunk(channel, input[channel] + offset, numChunk);
+            this->readResults(channel, output[channel] + offset, numChunk);
+        }
+
+        this->advanceHop(0);
+
+        offset += numChunk;
+        numRemaining -= numChunk;
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::write(unsigned channel, float sample)
+{
+    const ScopedNoAllocation noAllocation;
+
+    this->unpackChannels();
+    this->writeChunk(channel, &sample, 1);
+    this->advanceHop(channel);
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+float FFTEngine<Order, NumOverlaps, Processor>::readResult(unsigned channel)
+{
+    const ScopedNoAllocation noAllocation;
+
+    float result;
+    this->readResults(channel, &result, 1);
+    return result;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::writeChunk(unsigned channel, const float* input, unsigned num)
+{
+    const unsigned oldWritePos = mWritePos[channel];
+
+    // the input ring holds a whole number of hops, so a chunk that stops at a hop boundary never wraps
+    jassert(oldWritePos + num <= inputSize);
+
+    const unsigned sampleIndex = this->getThenIncrementWrite(channel, num);
+    juce::FloatVectorOperations::copy(m_inputAudio.getWritePointer(channel, static_cast<int>(sampleIndex)), input, static_cast<int>(num));
+
+    if (mWritePos[channel] < oldWritePos) {
+        m_minSamplesReached[channel] = true;
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::readResults(unsigned channel, float* output, unsigned num)
+{
+    const float* resultData = mResultBuffer.getReadPointer(channel);
+    const unsigned numAvailable = juce::jmin(num, mNumResults[channel]);
+    const unsigned readPos = this->getThenIncrementReadResult(channel, numAvailable);
+    const unsigned numBeforeWrap = juce::jmin(numAvailable, windowSize - readPos);
+
+    juce::FloatVectorOperations::copy(output, resultData + readPos, static_cast<int>(numBeforeWrap));
+    juce::FloatVectorOperations::copy(output + numBeforeWrap, resultData, static_cast<int>(numAvailable - numBeforeWrap));
+    juce::FloatVectorOperations::clear(output + numAvailable, static_cast<int>(num - numAvailable));
+
+    mNumResults[channel] -= numAvailable;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+unsigned FFTEngine<Order, NumOverlaps, Processor>::getWritePos(unsigned channel) const
+{
+    return mWritePos[channel];
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+unsigned FFTEngine<Order, NumOverlaps, Processor>::getThenIncrementWrite(unsigned channel, unsigned num)
+{
+    unsigned prev = mWritePos[channel];
+    mWritePos[channel] = (prev + num) & inputMask;
+    return prev;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+unsigned FFTEngine<Order, NumOverlaps, Processor>::getThenIncrementReadResult(unsigned channel, unsigned num)
+{
+    unsigned prev = mResultReadPos[channel];
+    mResultReadPos[channel] = (prev + num) & windowMask;
+    return prev;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+unsigned FFTEngine<Order, NumOverlaps, Processor>::getThenIncrementWriteResult(unsigned channel, unsigned num)
+{
+    unsigned prev = mResultWritePos[channel];
+    mResultWritePos[channel] = (prev + num) & windowMask;
+    return prev;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::advanceHop(unsigned channel)
+{
+    const unsigned hopPosition = mWritePos[channel] & hopMask;
+
+    if (hopPosition == 0 && m_minSamplesReached[channel]) {
+        this->performFFT(channel);
+    } else if (m_scheduling == FFTScheduling::amortized) {
+        this->advanceFrame(channel, this->getDueStage(hopPosition));
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::performFFT(const unsigned channel)
+{
+    if (m_scheduling == FFTScheduling::worker) {
+        // the previous frame has had a whole hop on the worker; collecting it first frees the workspace
+        this->collectFrame(channel);
+        this->gatherFrame(channel, mWritePos[channel]);
+        this->submitFrame(channel);
+        return;
+    }
+
+    if (m_scheduling == FFTScheduling::amortized) {
+        // whatever the previous frame has left runs now; the new frame's input is only complete at the boundary
+        this->advanceFrame(channel, stageComplete);
+        mFrameStages[channel] = stageGather;
+        this->advanceFrame(channel, stageForward);
+        return;
+    }
+
+    this->gatherFrame(channel, mWritePos[channel]);
+    this->transformFrame(channel);
+    this->overlapAddFrame(channel);
+}
+
+// switches a packed engine to a real transform per channel for good, mid-stream: a packed frame leaves each channel's
+// data in its own workspace in the same layout an unpacked one does, so a frame part way through its stages only needs
+// channel 1 to pick up channel 0's progress, and one on the worker is collected while it still covers both channels
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::unpackChannels()
+{
+    if (!m_isStereoPacked) {
+        return;
+    }
+
+    // results are read in order, so overlap-adding the frame up to a hop early changes nothing but when it lands
+    this->collectFrame(0);
+    mFrameStages[1] = mFrameStages[0];
+
+    // frames submitted from here on are published to the worker after this through the job queue
+    m_isStereoPacked = false;
+}
+
+// the channels one frame covers: channel 0 stands for both when packed
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+unsigned FFTEngine<Order, NumOverlaps, Processor>::getFrameEnd(unsigned channel) const
+{
+    return channel + (m_isStereoPacked ? 2 : 1);
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+float* FFTEngine<Order, NumOverlaps, Processor>::getFrameData(unsigned channel, unsigned slot)
+{
+    if (slot == 0) {
+        return m_fftWorkspace.getWritePointer(static_cast<int>(channel));
+    }
+
+    const unsigned numChannels = static_cast<unsigned>(mNumResults.size());
+    return m_batchWorkspace.getWritePointer(static_cast<int>((slot - 1) * numChannels + channel));
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+std::complex<float>* FFTEngine<Order, NumOverlaps, Processor>::getPackedSignal(unsigned slot)
+{
+    return slot == 0 ? m_packedSignal.data() : m_batchPackedSignal.data() + (slot - 1) * windowSize;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+std::complex<float>* FFTEngine<Order, NumOverlaps, Processor>::getPackedSpectrum(unsigned slot)
+{
+    return slot == 0 ? m_packedSpectrum.data() : m_batchPackedSpectrum.data() + (slot - 1) * windowSize;
+}
+
+// gathers the window of input that ends at frameEnd in the input ring
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::gatherFrame(unsigned channel, unsigned frameEnd, unsigned slot)
+{
+    for (unsigned frameChannel = channel; frameChannel < this->getFrameEnd(channel); ++frameChannel) {
+        this->gatherChannel(frameChannel, frameEnd, slot);
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::gatherChannel(unsigned channel, unsigned frameEnd, unsigned slot)
+{
+    const float* audioInputData = m_inputAudio.getReadPointer(channel);
+    unsigned int bufferBase = (frameEnd - windowSize) & inputMask;
+
+    // real-only transforms need room for the interleaved complex spectrum, hence twice the window
+    float* fftData = this->getFrameData(channel, slot);
+
+    // the window is at most two contiguous runs of the input ring
+    const unsigned numBeforeWrap = juce::jmin(windowSize, inputSize - bufferBase);
+    std::copy_n(audioInputData + bufferBase, numBeforeWrap, fftData);
+    std::copy_n(audioInputData, windowSize - numBeforeWrap, fftData + numBeforeWrap);
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::forwardTransformFrame(unsigned channel, unsigned slot)
+{
+    if (m_isStereoPacked) {
+        this->forwardTransformPair(slot);
+    } else {
+        this->forwardTransformReal(channel, this->getFrameData(channel, slot));
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::processFrame(unsigned channel, unsigned slot)
+{
+    for (unsigned frameChannel = channel; frameChannel < this->getFrameEnd(channel); ++frameChannel) {
+        m_processor(reinterpret_cast<std::complex<float>*>(this->getFrameData(frameChannel, slot)), frameChannel);
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::inverseTransformFrame(unsigned channel, unsigned slot)
+{
+    if (m_isStereoPacked) {
+        this->inverseTransformPair(slot);
+    } else {
+        this->inverseTransformReal(channel, this->getFrameData(channel, slot));
+    }
+
+    // the windowed frame stays in the workspace until overlap-add, which may run on another thread
+    for (unsigned frameChannel = channel; frameChannel < this->getFrameEnd(channel); ++frameChannel) {
+        float* fftData = this->getFrameData(frameChannel, slot);
+        SpectralKernels::multiply(fftData, fftData, m_windowTable->data(), static_cast<int>(windowSize));
+    }
+}
+
+// transforms the even samples as the real part and the odd ones as the imaginary part of a half size signal, separates
+// the two half spectra the same way forwardTransformPair separates its channels, and combines them as the first step
+// of a radix-2 FFT would; the half spectrum goes through the second half of the frame's workspace, which is free
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::forwardTransformReal(unsigned channel, float* fftData)
+{
+    constexpr unsigned halfSize = windowSize / 2;
+
+    auto* bins = reinterpret_cast<std::complex<float>*>(fftData);
+    std::complex<float>* halfSpectrum = bins + halfSize;
+    const std::complex<float>* twiddles = m_realTwiddles->data();
+
+    m_halfFFTs[channel]->perform(bins, halfSpectrum, false);
+
+    // the nyquist bin is written over the half spectrum's first bin, so that one is combined last
+    for (unsigned bin = 1; bin < halfSize; ++bin) {
+        const std::complex<float> halfBin = halfSpectrum[bin];
+        const std::complex<float> mirroredBin = std::conj(halfSpectrum[halfSize - bin]);
+        const std::complex<float> evenBin = 0.5f * (halfBin + mirroredBin);
+        const std::complex<float> oddBin = std::complex<float>(0.f, -0.5f) * (halfBin - mirroredBin);
+
+        bins[bin] = evenBin + twiddles[bin] * oddBin;
+    }
+
+    const std::complex<float> firstBin = halfSpectrum[0];
+    bins[0] = { firstBin.real() + firstBin.imag(), 0.f };
+    bins[halfSize] = { firstBin.real() - firstBin.imag(), 0.f };
+}
+
+// the reverse of forwardTransformReal: the even and odd samples' spectra are recovered from each bin and its mirror,
+// and the inverse of even + i * odd carries the even samples in its real part and the odd ones in its imaginary part;
+// as with JUCE's real-only inverse, only the real parts of the dc and nyquist bins count
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::inverseTransformReal(unsigned channel, float* fftData)
+{
+    constexpr unsigned halfSize = windowSize / 2;
+
+    auto* bins = reinterpret_cast<std::complex<float>*>(fftData);
+    std::complex<float>* halfSpectrum = bins + halfSize;
+    const std::complex<float>* twiddles = m_realTwiddles->data();
+
+    // the half spectrum's first bin overlays the nyquist bin, so both ends are read before anything is written
+    const float dc = bins[0].real();
+    const float nyquist = bins[halfSize].real();
+
+    for (unsigned bin = 1; bin < halfSize; ++bin) {
+        const std::complex<float> fullBin = bins[bin];
+        const std::complex<float> mirroredBin = std::conj(bins[halfSize - bin]);
+        const std::complex<float> evenBin = 0.5f * (fullBin + mirroredBin);
+        const std::complex<float> oddBin = 0.5f * (fullBin - mirroredBin) * std::conj(twiddles[bin]);
+
+        halfSpectrum[bin] = evenBin + std::complex<float>(0.f, 1.f) * oddBin;
+    }
+
+    halfSpectrum[0] = { 0.5f * (dc + nyquist), 0.5f * (dc - nyquist) };
+
+    m_halfFFTs[channel]->perform(halfSpectrum, bins, true);
+}
+
+// transforms left + i * right, then separates the two spectra: a real signal's spectrum is conjugate symmetric and an
+// imaginary one's is conjugate antisymmetric, so each bin and the conjugate of its mirror give their sum and difference
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::forwardTransformPair(unsigned slot)
+{
+    float* leftData = this->getFrameData(0, slot);
+    float* rightData = this->getFrameData(1, slot);
+    std::complex<float>* packedSignal = this->getPackedSignal(slot);
+    std::complex<float>* packedSpectrum = this->getPackedSpectrum(slot);
+
+    for (unsigned i = 0; i < windowSize; ++i) {
+        packedSignal[i] = { leftData[i], rightData[i] };
+    }
+
+    mFFT->perform(packedSignal, packedSpectrum, false);
+
+    auto* leftBins = reinterpret_cast<std::complex<float>*>(leftData);
+    auto* rightBins = reinterpret_cast<std::complex<float>*>(rightData);
+
+    for (unsigned bin = 0; bin <= windowSize / 2; ++bin) {
+        const std::complex<float> packedBin = packedSpectrum[bin];
+        const std::complex<float> mirroredBin = std::conj(packedSpectrum[(windowSize - bin) & windowMask]);
+
+        leftBins[bin] = 0.5f * (packedBin + mirroredBin);
+        rightBins[bin] = std::complex<float>(0.f, -0.5f) * (packedBin - mirroredBin);
+    }
+}
+
+// the reverse of forwardTransformPair: the two conjugate symmetric spectra are recombined as left + i * right, whose
+// inverse carries left in its real part and right in its imaginary part
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::inverseTransformPair(unsigned slot)
+{
+    constexpr unsigned nyquistBin = windowSize / 2;
+    const std::complex<float> imaginaryUnit(0.f, 1.f);
+
+    float* leftData = this->getFrameData(0, slot);
+    float* rightData = this->getFrameData(1, slot);
+    std::complex<float>* packedSignal = this->getPackedSignal(slot);
+    std::complex<float>* packedSpectrum = this->getPackedSpectrum(slot);
+
+    const auto* leftBins = reinterpret_cast<const std::complex<float>*>(leftData);
+    const auto* rightBins = reinterpret_cast<const std::complex<float>*>(rightData);
+
+    // only the real parts of dc and nyquist survive a real-only inverse, so only they are kept here
+    packedSpectrum[0] = { leftBins[0].real(), rightBins[0].real() };
+    packedSpectrum[nyquistBin] = { leftBins[nyquistBin].real(), rightBins[nyquistBin].real() };
+
+    for (unsigned bin = 1; bin < nyquistBin; ++bin) {
+        packedSpectrum[bin] = leftBins[bin] + imaginaryUnit * rightBins[bin];
+        packedSpectrum[windowSize - bin] = std::conj(leftBins[bin]) + imaginaryUnit * std::conj(rightBins[bin]);
+    }
+
+    mFFT->perform(packedSpectrum, packedSignal, true);
+
+    for (unsigned i = 0; i < windowSize; ++i) {
+        leftData[i] = packedSignal[i].real();
+        rightData[i] = packedSignal[i].imag();
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::transformFrame(unsigned channel)
+{
+    this->forwardTransformFrame(channel);
+    this->processFrame(channel);
+    this->inverseTransformFrame(channel);
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::runFrameStage(unsigned channel, int stage)
+{
+    switch (stage) {
+        case stageGather:
+            this->gatherFrame(channel, mWritePos[channel]);
+            break;
+        case stageForward:
+            this->forwardTransformFrame(channel);
+            break;
+        case stageProcess:
+            this->processFrame(channel);
+            break;
+        case stageInverse:
+            this->inverseTransformFrame(channel);
+            break;
+        case stageOverlapAdd:
+            this->overlapAddFrame(channel);
+            break;
+        default:
+            jassertfalse;
+            break;
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::advanceFrame(unsigned channel, int targetStage)
+{
+    while (mFrameStages[channel] < targetStage) {
+        this->runFrameStage(channel, mFrameStages[channel]++);
+    }
+}
+
+// the transform stages are due at the first, second and third quarter of the hop; overlap-add and the
+// next gather share the boundary, where both are cheap
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+int FFTEngine<Order, NumOverlaps, Processor>::getDueStage(unsigned hopPosition) const
+{
+    return stageForward + static_cast<int>((4 * hopPosition) / hopSize);
+}
+
+// adds the frame into the accumulator, whose oldest hop has then received every frame overlapping it and is moved
+// out to the results; memory stays at one window and the hop readout does not depend on the overlap
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::overlapAddFrame(unsigned channel, unsigned slot)
+{
+    for (unsigned frameChannel = channel; frameChannel < this->getFrameEnd(channel); ++frameChannel) {
+        this->overlapAddChannel(frameChannel, slot);
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::overlapAddChannel(unsigned channel, unsigned slot)
+{
+    const float* frameData = this->getFrameData(channel, slot);
+    float* accumulatorData = m_overlapAccumulator.getWritePointer(channel);
+    const unsigned accumulatorPos = mAccumulatorPos[channel];
+    const unsigned numBeforeWrap = windowSize - accumulatorPos;
+
+    SpectralKernels::add(accumulatorData + accumulatorPos, frameData, static_cast<int>(numBeforeWrap));
+    SpectralKernels::add(accumulatorData, frameData + numBeforeWrap, static_cast<int>(accumulatorPos));
+
+    // results are written a hop at a time, so the hop always lands contiguously in the ring
+    jassert(mNumResults[channel] + hopSize <= windowSize);
+    jassert((mResultWritePos[channel] & hopMask) == 0);
+
+    float* resultData = mResultBuffer.getWritePointer(channel, static_cast<int>(this->getThenIncrementWriteResult(channel, hopSize)));
+    std::copy_n(accumulatorData + accumulatorPos, hopSize, resultData);
+    juce::FloatVectorOperations::clear(accumulatorData + accumulatorPos, static_cast<int>(hopSize));
+
+    mNumResults[channel] += hopSize;
+    mAccumulatorPos[channel] = (accumulatorPos + hopSize) & windowMask;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::submitFrame(unsigned channel)
+{
+    mFrameStates[channel] = frameQueued;
+
+    // a full queue only means the frame is picked up by collectFrame instead of the worker
+    int start1, size1, start2, size2;
+    m_jobFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 > 0) {
+        m_jobQueue[static_cast<size_t>(start1)] = channel;
+        m_jobFifo.finishedWrite(1);
+
+        // an engine put in worker mode without prepareScheduling() has no worker, and collectFrame runs the frame itself
+        if (m_worker != nullptr) {
+            m_worker->wakeUp();
+        }
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::collectFrame(unsigned channel)
+{
+    if (mFrameStates[channel] == frameIdle) {
+        return;
+    }
+
+    // a frame the worker has not started yet is cheaper to run here than to wait for
+    if (!this->runQueuedFrame(channel)) {
+        while (mFrameStates[channel] != frameDone) {
+            std::this_thread::yield();
+        }
+    }
+
+    this->overlapAddFrame(channel);
+    mFrameStates[channel] = frameIdle;
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+bool FFTEngine<Order, NumOverlaps, Processor>::runQueuedFrame(unsigned channel)
+{
+    int expected = frameQueued;
+
+    if (!mFrameStates[channel].compare_exchange_strong(expected, frameRunning)) {
+        return false;
+    }
+
+    this->transformFrame(channel);
+    mFrameStates[channel] = frameDone;
+    return true;
+}
+
+// called on the worker thread; entries whose frame was already claimed by the audio thread are skipped
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::runQueuedFrames()
+{
+    const ScopedNoAllocation noAllocation;
+
+    int start1, size1, start2, size2;
+    m_jobFifo.prepareToRead(m_jobFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i) {
+        this->runQueuedFrame(m_jobQueue[static_cast<size_t>(start1 + i)]);
+    }
+
+    for (int i = 0; i < size2; ++i) {
+        this->runQueuedFrame(m_jobQueue[static_cast<size_t>(start2 + i)]);
+    }
+
+    m_jobFifo.finishedRead(size1 + size2);
+}
+
+// waits out any frame the worker is still running and forgets the rest
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::settleFrames()
+{
+    for (auto& frameState : mFrameStates) {
+        int expected = frameQueued;
+
+        if (!frameState.compare_exchange_strong(expected, frameIdle)) {
+            while (frameState == frameRunning) {
+                std::this_thread::yield();
+            }
+        }
+
+        frameState = frameIdle;
+    }
+}
+
+// each batch is written to the input ring whole and its frames are transformed across the pool; the results are then
+// read out in the same pieces, between the same overlap-adds, as immediate would, so the output is identical
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::processBatches(const float* const* input, float* const* output, int numSamples)
+{
+    const ScopedNoAllocation noAllocation;
+
+    // a packed pair is one frame, so it is one job
+    const unsigned channelStep = m_isStereoPacked ? 2 : 1;
+    const int numGroups = static_cast<int>(mNumResults.size() / channelStep);
+
+    unsigned offset = 0;
+    unsigned numRemaining = static_cast<unsigned>(numSamples);
+
+    while (numRemaining > 0) {
+        // a batch ends at most a window minus a hop past the next hop boundary, so the input of every frame it completes
+        // is still in the ring once the whole batch has been written
+        const unsigned batchStart = mWritePos[0];
+        const unsigned numToBoundary = hopSize - (batchStart & hopMask);
+        const unsigned numBatch = juce::jmin(numRemaining, numToBoundary + windowSize - hopSize);
+
+        const unsigned numFrames = this->writeBatch(input, offset, numBatch);
+        const int numFrameJobs = static_cast<int>(numFrames) * numGroups;
+
+        auto forwardTransform = [this, numGroups, channelStep](int job) {
+            const unsigned frame = static_cast<unsigned>(job / numGroups);
+            const unsigned channel = static_cast<unsigned>(job % numGroups) * channelStep;
+
+            this->gatherFrame(channel, m_batchFrameEnds[frame], frame + 1);
+            this->forwardTransformFrame(channel, frame + 1);
+        };
+
+        // the processor may keep state per channel, so it sees each channel's frames in order and on one thread
+        auto processFrames = [this, numFrames, channelStep](int group) {
+            for (unsigned frame = 0; frame < numFrames; ++frame) {
+                this->processFrame(static_cast<unsigned>(group) * channelStep, frame + 1);
+            }
+        };
+
+        auto inverseTransform = [this, numGroups, channelStep](int job) {
+            const unsigned frame = static_cast<unsigned>(job / numGroups);
+            const unsigned channel = static_cast<unsigned>(job % numGroups) * channelStep;
+
+            this->inverseTransformFrame(channel, frame + 1);
+        };
+
+        auto readOut = [this, output, offset, batchStart, numBatch, numFrames, channelStep](int group) {
+            this->readBatch(static_cast<unsigned>(group) * channelStep, output, offset, batchStart, numBatch, numFrames);
+        };
+
+        this->runBatchJobs(numFrameJobs, forwardTransform);
+        this->runBatchJobs(numFrames > 0 ? numGroups : 0, processFrames);
+        this->runBatchJobs(numFrameJobs, inverseTransform);
+        this->runBatchJobs(numGroups, readOut);
+
+        offset += numBatch;
+        numRemaining -= numBatch;
+    }
+}
+
+// writes a batch of every channel into the input ring a hop at a time, noting where each frame it completes ends;
+// returns how many it completes
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+unsigned FFTEngine<Order, NumOverlaps, Processor>::writeBatch(const float* const* input, unsigned offset, unsigned numSamples)
+{
+    const unsigned numChannels = static_cast<unsigned>(mNumResults.size());
+    unsigned numFrames = 0;
+    unsigned numWritten = 0;
+
+    while (numWritten < numSamples) {
+        // the channels move in lockstep, so channel 0's position stands for all of them
+        const unsigned numChunk = juce::jmin(numSamples - numWritten, hopSize - (mWritePos[0] & hopMask));
+
+        for (unsigned channel = 0; channel < numChannels; ++channel) {
+            jassert(mWritePos[channel] == mWritePos[0]);
+            this->writeChunk(channel, input[channel] + offset + numWritten, numChunk);
+        }
+
+        numWritten += numChunk;
+
+        if ((mWritePos[0] & hopMask) == 0 && m_minSamplesReached[0]) {
+            m_batchFrameEnds[numFrames++] = mWritePos[0];
+        }
+    }
+
+    return numFrames;
+}
+
+// reads a batch's results for the channels of one frame, overlap-adding each of its frames at the hop boundary where
+// it was completed
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+void FFTEngine<Order, NumOverlaps, Processor>::readBatch(unsigned channel,
+                                                         float* const* output,
+                                                         unsigned offset,
+                                                         unsigned batchStart,
+                                                         unsigned numSamples,
+                                                         unsigned numFrames)
+{
+    unsigned frame = 0;
+    unsigned numRead = 0;
+    unsigned position = batchStart;
+
+    while (numRead < numSamples) {
+        const unsigned numChunk = juce::jmin(numSamples - numRead, hopSize - (position & hopMask));
+
+        for (unsigned frameChannel = channel; frameChannel < this->getFrameEnd(channel); ++frameChannel) {
+            this->readResults(frameChannel, output[frameChannel] + offset + numRead, numChunk);
+        }
+
+        numRead += numChunk;
+        position = (position + numChunk) & inputMask;
+
+        if (frame < numFrames && position == m_batchFrameEnds[frame]) {
+            this->overlapAddFrame(channel, frame + 1);
+            ++frame;
+        }
+    }
+}
+
+template<unsigned Order, unsigned NumOverlaps, typename Processor>
+template<typename Function>
+void FFTEngine<Order, NumOverlaps, Processor>::runBatchJobs(int numJobs, Function& function)
+{
+    if (m_workerPool != nullptr && numJobs > 1) {
+        m_workerPool->run(numJobs, function);
+        return;
+    }
+
+    for (int job = 0; job < numJobs; ++job) {
+        function(job);
+    }
+}
@@ -0,0 +1,73 @@
+#include "FFTTableCache.h"
+
+#include <numeric>
+
+// the fallback FFT takes a lock inside every transform and IPP works in a buffer that belongs to the plan, so a plan is
+// only worth sharing on the backends that keep no per-call state in it
+#if JUCE_DSP_USE_SHARED_FFTW || JUCE_DSP_USE_STATIC_FFTW || JUCE_MAC || JUCE_IOS
+#define FFT_TABLE_CACHE_SHARES_PLANS 1
+#else
+#define FFT_TABLE_CACHE_SHARES_PLANS 0
+#endif
+
+std::shared_ptr<const juce::dsp::FFT> FFTTableCache::getPlan(unsigned order)
+{
+#if FFT_TABLE_CACHE_SHARES_PLANS
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    return findOrCreate(m_plans, order, [order] { return std::make_shared<const juce::dsp::FFT>(static_cast<int>(order)); });
+#else
+    return std::make_shared<const juce::dsp::FFT>(static_cast<int>(order));
+#endif
+}
+
+std::shared_ptr<const std::vector<float>> FFTTableCache::getSynthesisWindow(WindowingMethod method, unsigned size, unsigned numOverlaps)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    return findOrCreate(m_windows, WindowKey(method, size, numOverlaps), [method, size, numOverlaps] {
+        std::vector<float> window(size + 1);
+
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), size + 1, method, false);
+        window.pop_back();
+
+        // at a power-of-two overlap a periodic hann adds up to sum / hop, which this scales to one
+        const float windowSum = std::accumulate(window.begin(), window.end(), 0.f);
+        juce::FloatVectorOperations::multiply(window.data(), static_cast<float>(size / numOverlaps) / windowSum, static_cast<int>(size));
+
+        return std::make_shared<const std::vector<float>>(std::move(window));
+    });
+}
+
+std::shared_ptr<const std::vector<std::complex<float>>> FFTTableCache::getRealTwiddles(unsigned size)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    return findOrCreate(m_twiddles, size, [size] {
+        std::vector<std::complex<float>> twiddles(size / 2 + 1);
+
+        // worked out in double, so that the largest sizes are as accurate as the smallest
+        for (unsigned k = 0; k < twiddles.size(); ++k) {
+            twiddles[k] = std::complex<float>(std::polar(1.0, -juce::MathConstants<double>::twoPi * k / size));
+        }
+
+        return std::make_shared<const std::vector<std::complex<float>>>(std::move(twiddles));
+    });
+}
+
+// entries whose tables have all been released are dropped on the way, so the maps never outgrow what is in use
+template<typename Key, typename Table, typename Create>
+std::shared_ptr<const Table> FFTTableCache::findOrCreate(std::map<Key, std::weak_ptr<const Table>>& tables, const Key& key, Create create)
+{
+    for (auto entry = tables.begin(); entry != tables.end();) {
+        entry = entry->second.expired() && entry->first != key ? tables.erase(entry) : std::next(entry);
+    }
+
+    if (auto table = tables[key].lock()) {
+        return table;
+    }
+
+    std::shared_ptr<const Table> table = create();
+    tables[key] = table;
+    return table;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <complex>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+// process-wide store of the immutable tables FFT engines are built from, reached through juce::SharedResourcePointer;
+// each table is handed out by reference count and freed with its last holder, and asking again for one that is still
+// held returns the same table rather than a copy
+class FFTTableCache
+{
+  public:
+    using WindowingMethod = juce::dsp::WindowingFunction<float>::WindowingMethod;
+
+    // a transform of 2^order points; shared only where the FFT backend runs one plan on several threads without locking,
+    // so elsewhere every call gets a plan of its own
+    std::shared_ptr<const juce::dsp::FFT> getPlan(unsigned order);
+
+    // a periodic window of the given size (the symmetric one a sample longer, minus its last point), scaled so that
+    // overlap-adding it at numOverlaps sums to one
+    std::shared_ptr<const std::vector<float>> getSynthesisWindow(WindowingMethod method, unsigned size, unsigned numOverlaps);
+
+    // e^(-2 pi i k / size) for k up to size / 2, which turn a transform of size / 2 complex points into one of size real
+    // points
+    std::shared_ptr<const std::vector<std::complex<float>>> getRealTwiddles(unsigned size);
+
+  private:
+    using WindowKey = std::tuple<WindowingMethod, unsigned, unsigned>;
+
+    // entries only watch their tables, so holding one here never keeps it alive
+    std::map<unsigned, std::weak_ptr<const juce::dsp::FFT>> m_plans;
+    std::map<WindowKey, std::weak_ptr<const std::vector<float>>> m_windows;
+    std::map<unsigned, std::weak_ptr<const std::vector<std::complex<float>>>> m_twiddles;
+
+    // engines are built on the message thread and on whatever threads offline renders use
+    std::mutex m_lock;
+
+    template<typename Key, typename Table, typename Create>
+    static std::shared_ptr<const Table> findOrCreate(std::map<Key, std::weak_ptr<const Table>>& tables, const Key& key, Create create);
+};
@@ -1,253 +1,620 @@
-#include <cmath>
-
-#include "PluginEditor.h"
-#include "PluginProcessor.h"
-
-PluginProcessor::PluginProcessor()
-  : AudioProcessor(BusesProperties().withInput("Input", juce::AudioChannelSet::stereo(), true).withOutput("Output", juce::AudioChannelSet::stereo(), true))
-  , m_circularAudioBuffers(NUM_CHANNELS)
-  , m_fftBuffer(NUM_CHANNELS,
-                2 * FFT_SIZE,
-                FFT_ORDER,
-                WINDOW_SIZE,
-                2,
-                [this](std::complex<float>* fftData, unsigned int channel) { this->processFFT(fftData, channel); })
-  , m_prevAudioBuffer(NUM_CHANNELS)
-  , m_prevSpectrum(NUM_CHANNELS)
-  , m_isSpectrumReady(false)
-  , m_params(*this,
-             nullptr,
-             juce::Identifier("fourier-filter"),
-             { std::make_unique<juce::AudioParameterFloat>("bands", "Bands", 0, 1.f, 0.5f),
-               std::make_unique<juce::AudioParameterFloat>("position", "Position", 0.f, 1.f, 0.5f),
-               std::make_unique<juce::AudioParameterFloat>("width", "Width", 0.f, 1.f, 0.5f),
-               std::make_unique<juce::AudioParameterFloat>("offset", "Offset", 0.f, 1.f, 0.f),
-               std::make_unique<juce::AudioParameterFloat>("bias", "Bias", -1.f, 1.f, 0.f),
-               std::make_unique<juce::AudioParameterFloat>("makeup", "Makeup", 0.f, 1.f, 0.f) })
-{
-    this->setLatencySamples(FFT_SIZE);
-
-    p_bands = m_params.getRawParameterValue("bands");
-    p_position = m_params.getRawParameterValue("position");
-    p_width = m_params.getRawParameterValue("width");
-    p_offset = m_params.getRawParameterValue("offset");
-    p_bias = m_params.getRawParameterValue("bias");
-    p_makeup = m_params.getRawParameterValue("makeup");
-
-    for (auto& circularAudioBuffer : m_circularAudioBuffers) {
-        circularAudioBuffer.resize(1024);
-    }
-
-    for (auto& channelAudioBuffer : m_prevAudioBuffer) {
-        channelAudioBuffer.resize(FFT_SIZE);
-    }
-
-    for (auto& channelSpectrum : m_prevSpectrum) {
-        channelSpectrum.resize(FFT_SIZE);
-    }
-}
-
-PluginProcessor::~PluginProcessor() {}
-
-const juce::String PluginProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool PluginProcessor::acceptsMidi() const
-{
-    return false;
-}
-
-bool PluginProcessor::producesMidi() const
-{
-    return false;
-}
-
-bool PluginProcessor::isMidiEffect() const
-{
-    return false;
-}
-
-double PluginProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int PluginProcessor::getNumPrograms()
-{
-    return 1;
-}
-
-int PluginProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void PluginProcessor::setCurrentProgram(int index) {}
-
-const juce::String PluginProcessor::getProgramName(int index)
-{
-    return {};
-}
-
-void PluginProcessor::changeProgramName(int index, const juce::String& newName) {}
-
-void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock) {}
-
-// called when playback stops
-void PluginProcessor::releaseResources()
-{
-    m_fftBuffer.clear();
-}
-
-bool PluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
-{
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono() && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo()) {
-        return false;
-    }
-
-    return true;
-}
-
-const uint32_t PARAM_MAX = 1024;
-
-void PluginProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessage)
-{
-    juce::ScopedNoDenormals noDenormals;
-    const auto totalNumInputChannels = getTotalNumInputChannels();
-    const auto totalNumOutputChannels = getTotalNumOutputChannels();
-    const auto numSamples = buffer.getNumSamples();
-
-    // clear input channels that have no corresponding output channels
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i) {
-        buffer.clear(i, 0, numSamples);
-    }
-
-    for (int channel = 0; channel < 2; ++channel) {
-        auto* channelData = buffer.getWritePointer(channel);
-
-        for (int sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex) {
-            float outputValue = m_fftBuffer.readResult(channel);
-            m_fftBuffer.write(channel, channelData[sampleIndex]);
-
-            channelData[sampleIndex] = outputValue;
-            m_circularAudioBuffers[channel].write(outputValue);
-        }
-
-        m_readWriteAudioBufferLock.lock();
-        memcpy(&m_prevAudioBuffer[channel][0], channelData, m_prevAudioBuffer[channel].size() * sizeof(float));
-        m_readWriteAudioBufferLock.unlock();
-    }
-}
-
-#define PI 3.1415926535
-#define TWO_PI 2.0 * PI
-
-void PluginProcessor::processFFT(std::complex<float>* fftData, unsigned int channel)
-{
-    const double bands = static_cast<double>((*p_bands).load());
-    const double position = static_cast<double>((*p_position).load());
-    const double width = static_cast<double>((*p_width).load());
-    const double offset = static_cast<double>((*p_offset).load());
-    const double bias = static_cast<double>((*p_bias).load());
-    const double makeup = static_cast<double>((*p_makeup).load());
-
-    // scale from [0.0, 1.0] to some custom values
-    // all of these numbers were just set to what sounds good
-    double bandsScaled = bands * 3.0;
-    double positionScaled = -position;
-    double widthScaled = pow(width * 5.0, 3.0);
-
-    // used to have separate phases for left and right channel
-    double phaseOffset = (2.0 * TWO_PI * channel - TWO_PI) * offset;
-
-    // used as a log-scaled makeup gain for individual bands
-    double makeupScaled = (std::pow(100.0, makeup) - 1) / (100.0 - 1);
-
-    // used to bias frequencies low or high; conditional to avoid division by zero
-    double biasScaled = bias == 0.0 ? 1.001 : std::pow(10, bias);
-
-    for (int i = 0; i <= WINDOW_SIZE / 2; ++i) {
-        double indexScaled = static_cast<double>(i) / (static_cast<double>(WINDOW_SIZE) / 2.0);
-        double indexBias = (std::pow(biasScaled, 5.0 * indexScaled) - 1.0) / (std::pow(biasScaled, 5.0) - 1.0);
-        double indexLog = log(static_cast<float>(i) * 12.0 * indexBias + 1.0) * bandsScaled + positionScaled;
-
-        double binScaleModulated = 0.5 * cos(TWO_PI * indexLog + phaseOffset) + 0.5;
-
-        double binScaleScaled = pow(binScaleModulated, widthScaled) * (1.0 + makeupScaled);
-        double binScaleClipped = juce::jlimit(0.0, 1.0, binScaleScaled * (1.0 + makeupScaled));
-
-        float scale = static_cast<float>(binScaleClipped) * (1.f + 3.f * *p_width);
-
-        std::complex<float>& fftBin = fftData[i];
-        std::complex<float>& fftBinMirrored = fftData[static_cast<int>(WINDOW_SIZE) - i];
-
-        fftBin *= scale;
-        fftBinMirrored *= scale;
-
-        m_readWriteSpectrumLock.lock();
-        m_prevSpectrum[channel][i] = { std::abs(fftBin), std::arg(fftBin) };
-        m_readWriteSpectrumLock.unlock();
-    }
-
-    m_isSpectrumReady.store(true);
-}
-
-bool PluginProcessor::hasEditor() const
-{
-    return true;
-}
-
-juce::AudioProcessorEditor* PluginProcessor::createEditor()
-{
-    return new PluginProcessorEditor(*this, m_params);
-}
-
-void PluginProcessor::getStateInformation(juce::MemoryBlock& destData)
-{
-    auto state = m_params.copyState();
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
-}
-
-void PluginProcessor::setStateInformation(const void* data, int sizeInBytes)
-{
-    std::unique_ptr<juce::XmlElement> xmlState(this->getXmlFromBinary(data, sizeInBytes));
-
-    if (xmlState.get() != nullptr && xmlState->hasTagName(m_params.state.getType())) {
-        m_params.replaceState(juce::ValueTree::fromXml(*xmlState));
-    }
-}
-
-bool PluginProcessor::isAudioBufferReady(uint32_t channel)
-{
-    return m_circularAudioBuffers[channel].isFilled();
-}
-
-void PluginProcessor::copyAudioBuffer(std::vector<float>& destination, uint32_t channel)
-{
-    m_circularAudioBuffers[channel].copyTo(destination);
-}
-
-bool PluginProcessor::isSpectrumReady()
-{
-    return m_isSpectrumReady.load();
-}
-
-void PluginProcessor::copySpectrum(std::vector<std::vector<Polar>>& destination)
-{
-    jassert(destination.size() == m_prevSpectrum.size());
-    jassert(destination[0].size() == m_prevSpectrum[0].size());
-
-    for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
-        m_readWriteSpectrumLock.lock();
-        memcpy(&destination[channel][0], &m_prevSpectrum[channel][0], m_prevSpectrum[channel].size() * sizeof(Polar));
-        m_readWriteSpectrumLock.unlock();
-    }
-}
-
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new PluginProcessor();
-}
+#include <cmath>
+
+#include "PluginEditor.h"
+#include "PluginProcessor.h"
+#include "SpectralKernels.h"
+
+// the plugin wrapper defines this for hosts; other targets built from these sources, such as the batch renderer, do not
+#ifndef JucePlugin_Name
+#define JucePlugin_Name "FourierFilter"
+#endif
+
+static_assert(MIN_FFT_ORDER >= FFTBuffer::minFFTOrder && MAX_FFT_ORDER <= FFTBuffer::maxFFTOrder, "every selectable size needs an engine");
+
+PluginProcessor::PluginProcessor()
+  : AudioProcessor(BusesProperties().withInput("Input", juce::AudioChannelSet::stereo(), true).withOutput("Output", juce::AudioChannelSet::stereo(), true))
+  , m_circularAudioBuffers(MAX_CHANNELS)
+  , m_params(*this,
+             nullptr,
+             juce::Identifier("fourier-filter"),
+             { std::make_unique<juce::AudioParameterFloat>("bands", "Bands", 0, 1.f, 0.5f),
+               std::make_unique<juce::AudioParameterFloat>("position", "Position", 0.f, 1.f, 0.5f),
+               std::make_unique<juce::AudioParameterFloat>("width", "Width", 0.f, 1.f, 0.5f),
+               std::make_unique<juce::AudioParameterFloat>("offset", "Offset", 0.f, 1.f, 0.f),
+               std::make_unique<juce::AudioParameterFloat>("bias", "Bias", -1.f, 1.f, 0.f),
+               std::make_unique<juce::AudioParameterFloat>("makeup", "Makeup", 0.f, 1.f, 0.f),
+               std::make_unique<juce::AudioParameterChoice>("scheduling", "Scheduling", juce::StringArray{ "Immediate", "Worker thread", "Amortized" }, 0),
+               std::make_unique<juce::AudioParameterChoice>("fftSize",
+                                                            "FFT Size",
+                                                            juce::StringArray{ "256", "512", "1024", "2048", "4096", "8192", "16384" },
+                                                            DEFAULT_FFT_ORDER - MIN_FFT_ORDER),
+               std::make_unique<juce::AudioParameterChoice>("overlap", "Overlap", juce::StringArray{ "2x", "4x", "8x" }, 0) })
+{
+    p_bands = m_params.getRawParameterValue("bands");
+    p_position = m_params.getRawParameterValue("position");
+    p_width = m_params.getRawParameterValue("width");
+    p_offset = m_params.getRawParameterValue("offset");
+    p_bias = m_params.getRawParameterValue("bias");
+    p_makeup = m_params.getRawParameterValue("makeup");
+    p_scheduling = m_params.getRawParameterValue("scheduling");
+    p_fftSize = m_params.getRawParameterValue("fftSize");
+    p_overlap = m_params.getRawParameterValue("overlap");
+
+    m_engine.store(new SpectralEngine(*this,
+                                      this->getRequestedNumChannels(),
+                                      this->getRequestedFFTOrder(),
+                                      this->getRequestedNumOverlaps(),
+                                      this->getRequestedScheduling(),
+                                      this->getBlockSize()));
+    this->setLatencySamples(static_cast<int>(m_engine.load()->fftBuffer.getLatencySamples()));
+
+    for (auto& circularAudioBuffer : m_circularAudioBuffers) {
+        circularAudioBuffer.resize(1024);
+    }
+}
+
+PluginProcessor::~PluginProcessor()
+{
+    this->cancelPendingUpdate();
+
+    delete m_retiredEngine.exchange(nullptr);
+    delete m_pendingEngine.exchange(nullptr);
+    delete m_incomingEngine.exchange(nullptr);
+    delete m_engine.exchange(nullptr);
+}
+
+PluginProcessor::SpectralEngine::SpectralEngine(
+    PluginProcessor& owner, unsigned channels, unsigned order, unsigned overlaps, FFTBuffer::Scheduling scheduling, int maxBlockSize)
+  : numChannels(channels)
+  , fftOrder(order)
+  , fftSize(1u << order)
+  , numBins(fftSize / 2 + 1)
+  , numOverlaps(overlaps)
+  , fftBuffer(numChannels, fftOrder, numOverlaps, FrameProcessor{ owner, *this })
+  , gainTables(numChannels, std::vector<float>(numBins))
+  , gainTableParameters(numChannels)
+  , isGainTableValid(numChannels, 0)
+  , samplesUntilAnalysis(numChannels, 0.0)
+  , warmUpBuffer(static_cast<int>(numChannels), juce::jmax(1, maxBlockSize))
+{
+    for (unsigned channel = 0; channel < numChannels; ++channel) {
+        spectrum.push_back(std::make_unique<TripleBuffer<std::vector<float>>>(std::vector<float>(numBins)));
+    }
+
+    fftBuffer.setWorkerPool(owner.getWorkerPool());
+    fftBuffer.prepareScheduling(scheduling);
+    fftBuffer.setScheduling(scheduling);
+
+    // the input ring fills over two latencies before anything is transformed, and the first full output comes a latency later
+    numWarmUpSamples = 3 * static_cast<int>(fftBuffer.getLatencySamples());
+}
+
+bool PluginProcessor::SpectralEngine::isConfiguredFor(unsigned channels, unsigned order, unsigned overlaps) const
+{
+    return numChannels == channels && fftOrder == order && numOverlaps == overlaps;
+}
+
+const juce::String PluginProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool PluginProcessor::acceptsMidi() const
+{
+    return false;
+}
+
+bool PluginProcessor::producesMidi() const
+{
+    return false;
+}
+
+bool PluginProcessor::isMidiEffect() const
+{
+    return false;
+}
+
+double PluginProcessor::getTailLengthSeconds() const
+{
+    return 0.0;
+}
+
+int PluginProcessor::getNumPrograms()
+{
+    return 1;
+}
+
+int PluginProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void PluginProcessor::setCurrentProgram(int index) {}
+
+const juce::String PluginProcessor::getProgramName(int index)
+{
+    return {};
+}
+
+void PluginProcessor::changeProgramName(int index, const juce::String& newName) {}
+
+void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    const auto scheduling = this->getRequestedScheduling();
+    const auto fftOrder = this->getRequestedFFTOrder();
+    const auto numOverlaps = this->getRequestedNumOverlaps();
+    const auto numChannels = this->getRequestedNumChannels();
+
+    // the audio thread is stopped here, so any queued engine can be settled synchronously
+    delete m_retiredEngine.exchange(nullptr);
+    delete m_pendingEngine.exchange(nullptr);
+    delete m_incomingEngine.exchange(nullptr);
+
+    this->prepareWorkerPool(numChannels);
+
+    if (!m_engine.load()->isConfiguredFor(numChannels, fftOrder, numOverlaps)) {
+        auto* engine = new SpectralEngine(*this, numChannels, fftOrder, numOverlaps, scheduling, samplesPerBlock);
+
+        m_engineLock.lock();
+        engine = m_engine.exchange(engine);
+        m_engineLock.unlock();
+
+        delete engine;
+    }
+
+    auto& fftBuffer = m_engine.load()->fftBuffer;
+
+    // an engine kept from before the pool was started picks it up here
+    fftBuffer.setWorkerPool(this->getWorkerPool());
+    fftBuffer.prepareScheduling(scheduling);
+    fftBuffer.setScheduling(scheduling);
+    fftBuffer.clear();
+
+    m_pendingLatencySamples.store(-1);
+    this->setLatencySamples(static_cast<int>(fftBuffer.getLatencySamples()));
+}
+
+// called when playback stops
+void PluginProcessor::releaseResources()
+{
+    m_engine.load()->fftBuffer.clear();
+}
+
+// any layout from mono up to a 7.1.4 bed, with the same channels in as out
+bool PluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+    const auto& outputChannels = layouts.getMainOutputChannelSet();
+
+    if (outputChannels.isDisabled() || outputChannels.size() > MAX_CHANNELS) {
+        return false;
+    }
+
+    return layouts.getMainInputChannelSet() == outputChannels;
+}
+
+const uint32_t PARAM_MAX = 1024;
+
+// offline renders batch their hops whatever the parameter says, and go back to it when realtime playback resumes
+FFTBuffer::Scheduling PluginProcessor::getRequestedScheduling() const
+{
+    if (this->isNonRealtime()) {
+        return FFTBuffer::Scheduling::batched;
+    }
+
+    return static_cast<FFTBuffer::Scheduling>(juce::roundToInt(p_scheduling->load()));
+}
+
+unsigned PluginProcessor::getRequestedFFTOrder() const
+{
+    return static_cast<unsigned>(MIN_FFT_ORDER + juce::roundToInt(p_fftSize->load()));
+}
+
+unsigned PluginProcessor::getRequestedNumOverlaps() const
+{
+    return 2u << juce::roundToInt(p_overlap->load());
+}
+
+unsigned PluginProcessor::getRequestedNumChannels() const
+{
+    return static_cast<unsigned>(juce::jlimit(1, static_cast<int>(MAX_CHANNELS), this->getTotalNumOutputChannels()));
+}
+
+// joins the shared pool on the message thread the first time a layout or an offline render can use it, which starts
+// the pool if this is the first instance to do so; instances that only ever play mono live never hold it
+void PluginProcessor::prepareWorkerPool(unsigned numChannels)
+{
+    if (!m_usesWorkerPool || m_workerPool != nullptr || (numChannels < FFTBuffer::minParallelChannels && !this->isNonRealtime())) {
+        return;
+    }
+
+    m_workerPool = std::make_unique<juce::SharedResourcePointer<RealtimeWorkerPool>>();
+}
+
+void PluginProcessor::setUsesWorkerPool(bool shouldUseWorkerPool)
+{
+    // engines may already be spreading work over a pool that was joined, so it is only ever declined up front
+    jassert(shouldUseWorkerPool || m_workerPool == nullptr);
+
+    m_usesWorkerPool = shouldUseWorkerPool;
+}
+
+RealtimeWorkerPool* PluginProcessor::getWorkerPool() const
+{
+    return m_workerPool != nullptr ? &m_workerPool->get() : nullptr;
+}
+
+// switches scheduling between blocks; anything that has to allocate is prepared on the message thread first
+void PluginProcessor::updateScheduling(SpectralEngine& engine)
+{
+    const auto scheduling = this->getRequestedScheduling();
+
+    if (scheduling == engine.fftBuffer.getScheduling()) {
+        return;
+    }
+
+    if (!engine.fftBuffer.isSchedulingPrepared(scheduling)) {
+        this->triggerAsyncUpdate();
+        return;
+    }
+
+    engine.fftBuffer.setScheduling(scheduling);
+    this->reportLatency(engine);
+}
+
+// takes the pending engine, if any, once the previous one has been handed back, so the retired slot never holds two;
+// once taken it belongs to the audio thread until it is swapped in, and the message thread can no longer cancel it
+PluginProcessor::SpectralEngine* PluginProcessor::getIncomingEngine()
+{
+    auto* incoming = m_incomingEngine.load();
+
+    if (incoming == nullptr && m_retiredEngine.load() == nullptr) {
+        incoming = m_pendingEngine.exchange(nullptr);
+        m_incomingEngine.store(incoming);
+    }
+
+    return incoming;
+}
+
+// runs the incoming engine alongside the current one on the same input until its output is live, then crossfades from
+// one to the other over a chunk and swaps it in; both engines run meanwhile, about three windows of the new size, so a
+// reconfiguration costs that much extra but never drops out. the output does shift by any change in latency
+void PluginProcessor::runIncomingEngine(SpectralEngine& engine, SpectralEngine& incoming, juce::AudioBuffer<float>& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int numBufferChannels = juce::jmin(buffer.getNumChannels(), static_cast<int>(MAX_CHANNELS));
+    const int numIncomingChannels = static_cast<int>(incoming.numChannels);
+    const int chunkSize = incoming.warmUpBuffer.getNumSamples();
+
+    // either engine leaves a block narrower than its layout dry, as it would on its own
+    const bool isEngineRunning = numBufferChannels >= static_cast<int>(engine.numChannels);
+
+    if (numBufferChannels < numIncomingChannels) {
+        if (isEngineRunning) {
+            engine.fftBuffer.process(buffer.getArrayOfWritePointers(), buffer.getArrayOfWritePointers(), numSamples);
+        }
+
+        return;
+    }
+
+    std::array<float*, MAX_CHANNELS> chunk{};
+    std::array<float*, MAX_CHANNELS> incomingChunk{};
+
+    for (int channel = 0; channel < numIncomingChannels; ++channel) {
+        incomingChunk[static_cast<size_t>(channel)] = incoming.warmUpBuffer.getWritePointer(channel);
+    }
+
+    for (int start = 0; start < numSamples; start += chunkSize) {
+        const int numChunkSamples = juce::jmin(chunkSize, numSamples - start);
+
+        for (int channel = 0; channel < numBufferChannels; ++channel) {
+            chunk[static_cast<size_t>(channel)] = buffer.getWritePointer(channel, start);
+        }
+
+        for (int channel = 0; channel < numIncomingChannels; ++channel) {
+            juce::FloatVectorOperations::copy(incomingChunk[static_cast<size_t>(channel)], chunk[static_cast<size_t>(channel)], numChunkSamples);
+        }
+
+        if (isEngineRunning) {
+            engine.fftBuffer.process(chunk.data(), chunk.data(), numChunkSamples);
+        }
+
+        incoming.fftBuffer.process(incomingChunk.data(), incomingChunk.data(), numChunkSamples);
+        incoming.numWarmUpSamples -= numChunkSamples;
+
+        if (incoming.numWarmUpSamples > 0) {
+            continue;
+        }
+
+        for (int channel = 0; channel < numIncomingChannels; ++channel) {
+            buffer.applyGainRamp(channel, start, numChunkSamples, 1.f, 0.f);
+            buffer.addFromWithRamp(channel, start, incomingChunk[static_cast<size_t>(channel)], numChunkSamples, 0.f, 1.f);
+        }
+
+        // the rest of the block is the incoming engine's alone
+        if (const int numRemaining = numSamples - start - numChunkSamples; numRemaining > 0) {
+            for (int channel = 0; channel < numBufferChannels; ++channel) {
+                chunk[static_cast<size_t>(channel)] += numChunkSamples;
+            }
+
+            incoming.fftBuffer.process(chunk.data(), chunk.data(), numRemaining);
+        }
+
+        this->swapEngine(&incoming);
+        return;
+    }
+}
+
+// the outgoing engine may be deleted as soon as it is retired, so nothing touches it after this
+void PluginProcessor::swapEngine(SpectralEngine* engine)
+{
+    m_retiredEngine.store(m_engine.exchange(engine));
+    m_incomingEngine.store(nullptr);
+    this->reportLatency(*engine);
+}
+
+// the host hears of it from the message thread, since setLatencySamples calls back into the host synchronously
+void PluginProcessor::reportLatency(const SpectralEngine& engine)
+{
+    m_pendingLatencySamples.store(static_cast<int>(engine.fftBuffer.getLatencySamples()));
+    this->triggerAsyncUpdate();
+}
+
+void PluginProcessor::handleAsyncUpdate()
+{
+    const auto scheduling = this->getRequestedScheduling();
+    const auto fftOrder = this->getRequestedFFTOrder();
+    const auto numOverlaps = this->getRequestedNumOverlaps();
+    const auto numChannels = this->getRequestedNumChannels();
+
+    if (const int latencySamples = m_pendingLatencySamples.exchange(-1); latencySamples >= 0) {
+        this->setLatencySamples(latencySamples);
+    }
+
+    // only this thread deletes engines, so pointers loaded here stay valid even if the audio thread swaps meanwhile
+    delete m_retiredEngine.exchange(nullptr);
+
+    // the audio thread may take the pending engine between these loads, in which case neither shows it and one redundant
+    // engine is built; it is swapped in behind the other, so the two still settle on the requested configuration
+    auto* engine = m_engine.load();
+    auto* pending = m_pendingEngine.load();
+    auto* incoming = m_incomingEngine.load();
+    auto* current = incoming != nullptr ? incoming : engine;
+
+    engine->fftBuffer.prepareScheduling(scheduling);
+
+    if ((pending != nullptr ? pending : current)->isConfiguredFor(numChannels, fftOrder, numOverlaps)) {
+        return;
+    }
+
+    this->prepareWorkerPool(numChannels);
+
+    delete m_pendingEngine.exchange(current->isConfiguredFor(numChannels, fftOrder, numOverlaps)
+                                      ? nullptr
+                                      : new SpectralEngine(*this, numChannels, fftOrder, numOverlaps, scheduling, this->getBlockSize()));
+}
+
+void PluginProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessage)
+{
+    juce::ScopedNoDenormals noDenormals;
+    const auto totalNumInputChannels = getTotalNumInputChannels();
+    const auto totalNumOutputChannels = getTotalNumOutputChannels();
+    const auto numSamples = buffer.getNumSamples();
+
+    auto* engine = m_engine.load();
+    auto* incomingEngine = this->getIncomingEngine();
+
+    this->updateScheduling(*engine);
+
+    if (!engine->isConfiguredFor(this->getRequestedNumChannels(), this->getRequestedFFTOrder(), this->getRequestedNumOverlaps())) {
+        this->triggerAsyncUpdate();
+    }
+
+    // clear input channels that have no corresponding output channels
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i) {
+        buffer.clear(i, 0, numSamples);
+    }
+
+    // read before the engine can be swapped out and retired
+    const int numChannels = static_cast<int>((incomingEngine != nullptr ? incomingEngine : engine)->numChannels);
+
+    if (incomingEngine != nullptr) {
+        this->runIncomingEngine(*engine, *incomingEngine, buffer);
+    } else if (buffer.getNumChannels() >= numChannels) {
+        // the channels go through together, so a stereo engine can pack them and a wide one can spread them out
+        engine->fftBuffer.process(buffer.getArrayOfWritePointers(), buffer.getArrayOfWritePointers(), numSamples);
+    }
+
+    // an engine built for a wider layout than this block leaves it dry until its replacement is swapped in
+    if (buffer.getNumChannels() >= numChannels) {
+        for (int channel = 0; channel < numChannels; ++channel) {
+            m_circularAudioBuffers[channel].write(buffer.getReadPointer(channel), static_cast<uint32_t>(numSamples));
+        }
+    }
+}
+
+#define PI 3.1415926535
+#define TWO_PI 2.0 * PI
+
+bool SpectralParameters::operator==(const SpectralParameters& rhs) const
+{
+    return bands == rhs.bands && position == rhs.position && width == rhs.width && offset == rhs.offset && bias == rhs.bias &&
+           makeup == rhs.makeup;
+}
+
+bool SpectralParameters::operator!=(const SpectralParameters& rhs) const
+{
+    return !(*this == rhs);
+}
+
+SpectralParameters PluginProcessor::getSpectralParameters() const
+{
+    return { p_bands->load(), p_position->load(), p_width->load(), p_offset->load(), p_bias->load(), p_makeup->load() };
+}
+
+void PluginProcessor::updateGainTable(SpectralEngine& engine, const SpectralParameters& parameters, unsigned int channel)
+{
+    if (engine.isGainTableValid[channel] && engine.gainTableParameters[channel] == parameters) {
+        return;
+    }
+
+    const double bands = static_cast<double>(parameters.bands);
+    const double position = static_cast<double>(parameters.position);
+    const double width = static_cast<double>(parameters.width);
+    const double offset = static_cast<double>(parameters.offset);
+    const double bias = static_cast<double>(parameters.bias);
+    const double makeup = static_cast<double>(parameters.makeup);
+
+    // scale from [0.0, 1.0] to some custom values
+    // all of these numbers were just set to what sounds good
+    double bandsScaled = bands * 3.0;
+    double positionScaled = -position;
+    double widthScaled = pow(width * 5.0, 3.0);
+
+    // used to have separate phases for left and right channel
+    double phaseOffset = (2.0 * TWO_PI * channel - TWO_PI) * offset;
+
+    // used as a log-scaled makeup gain for individual bands
+    double makeupScaled = (std::pow(100.0, makeup) - 1) / (100.0 - 1);
+
+    // used to bias frequencies low or high; conditional to avoid division by zero
+    double biasScaled = bias == 0.0 ? 1.001 : std::pow(10, bias);
+
+    float* gainTable = engine.gainTables[channel].data();
+
+    for (unsigned i = 0; i < engine.numBins; ++i) {
+        double indexScaled = static_cast<double>(i) / (static_cast<double>(engine.fftSize) / 2.0);
+        double indexBias = (std::pow(biasScaled, 5.0 * indexScaled) - 1.0) / (std::pow(biasScaled, 5.0) - 1.0);
+        double indexLog = log(static_cast<float>(i) * 12.0 * indexBias + 1.0) * bandsScaled + positionScaled;
+
+        double binScaleModulated = 0.5 * cos(TWO_PI * indexLog + phaseOffset) + 0.5;
+
+        double binScaleScaled = pow(binScaleModulated, widthScaled) * (1.0 + makeupScaled);
+        double binScaleClipped = juce::jlimit(0.0, 1.0, binScaleScaled * (1.0 + makeupScaled));
+
+        gainTable[i] = static_cast<float>(binScaleClipped) * (1.f + 3.f * parameters.width);
+    }
+
+    engine.gainTableParameters[channel] = parameters;
+    engine.isGainTableValid[channel] = 1;
+}
+
+void PluginProcessor::applyGainTable(SpectralEngine& engine, std::complex<float>* fftData, unsigned int channel)
+{
+    SpectralKernels::multiplyBins(fftData, engine.gainTables[channel].data(), engine.numBins);
+}
+
+void PluginProcessor::processFFT(SpectralEngine& engine, std::complex<float>* fftData, unsigned int channel)
+{
+    this->updateGainTable(engine, this->getSpectralParameters(), channel);
+    this->applyGainTable(engine, fftData, channel);
+    this->analyseFrame(engine, fftData, channel);
+}
+
+void PluginProcessor::analyseFrame(SpectralEngine& engine, const std::complex<float>* fftData, unsigned int channel)
+{
+    const double frameRate = m_analysisFrameRate.load(std::memory_order_relaxed);
+
+    if (frameRate <= 0.0) {
+        return;
+    }
+
+    // every frame advances the stream by one hop
+    double& samplesUntilAnalysis = engine.samplesUntilAnalysis[channel];
+    samplesUntilAnalysis -= static_cast<double>(engine.fftSize / engine.numOverlaps);
+
+    if (samplesUntilAnalysis > 0.0) {
+        return;
+    }
+
+    samplesUntilAnalysis += this->getSampleRate() / frameRate;
+
+    auto& spectrum = *engine.spectrum[channel];
+    auto& frame = spectrum.getWriteFrame();
+
+    if (m_analysisScale.load(std::memory_order_relaxed) == SpectrumScale::power) {
+        SpectralKernels::binPowers(frame.data(), fftData, static_cast<int>(engine.numBins));
+    } else {
+        SpectralKernels::binMagnitudes(frame.data(), fftData, static_cast<int>(engine.numBins));
+    }
+
+    spectrum.publish();
+}
+
+bool PluginProcessor::hasEditor() const
+{
+    return true;
+}
+
+juce::AudioProcessorEditor* PluginProcessor::createEditor()
+{
+    return new PluginProcessorEditor(*this, m_params);
+}
+
+void PluginProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+    auto state = m_params.copyState();
+    std::unique_ptr<juce::XmlElement> xml(state.createXml());
+    copyXmlToBinary(*xml, destData);
+}
+
+void PluginProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    std::unique_ptr<juce::XmlElement> xmlState(this->getXmlFromBinary(data, sizeInBytes));
+
+    if (xmlState.get() != nullptr && xmlState->hasTagName(m_params.state.getType())) {
+        m_params.replaceState(juce::ValueTree::fromXml(*xmlState));
+    }
+}
+
+bool PluginProcessor::isAudioBufferReady(uint32_t channel)
+{
+    return m_circularAudioBuffers[channel].isFilled();
+}
+
+bool PluginProcessor::copyAudioBuffer(std::vector<float>& destination, uint32_t channel)
+{
+    return m_circularAudioBuffers[channel].copyTo(destination);
+}
+
+void PluginProcessor::startAnalysis(double maxFrameRate, SpectrumScale scale)
+{
+    jassert(maxFrameRate > 0.0);
+
+    m_analysisScale.store(scale);
+    m_analysisFrameRate.store(maxFrameRate);
+}
+
+void PluginProcessor::stopAnalysis()
+{
+    m_analysisFrameRate.store(0.0);
+}
+
+// the spectrum follows the FFT size, so the destination is resized here on the caller's thread
+bool PluginProcessor::copySpectrum(std::vector<std::vector<float>>& destination)
+{
+    const std::lock_guard<std::mutex> lock(m_engineLock);
+    const auto* engine = m_engine.load();
+    bool isNewFrame = false;
+
+    destination.resize(engine->numChannels);
+
+    for (unsigned channel = 0; channel < engine->numChannels; ++channel) {
+        auto& spectrum = *engine->spectrum[channel];
+
+        // a channel whose frame counter has not moved is left as it is, unless the engine changed under it
+        if (!spectrum.update() && destination[channel].size() == engine->numBins) {
+            continue;
+        }
+
+        destination[channel].resize(engine->numBins);
+        memcpy(&destination[channel][0], spectrum.getReadFrame().data(), engine->numBins * sizeof(float));
+        isNewFrame = true;
+    }
+
+    return isNewFrame;
+}
+
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new PluginProcessor();
+}
@@ -1,103 +1,214 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-#include "CircularBuffer.h"
-#include "FFTBuffer.h"
-
-struct Polar
-{
-    float amplitude;
-    float phase;
-};
-
-enum
-{
-    FFT_ORDER = 12,
-    FFT_SIZE = 1 << FFT_ORDER,
-    WINDOW_SIZE = FFT_SIZE,
-    NUM_CHANNELS = 2,
-};
-
-//==============================================================================
-/**
- */
-class PluginProcessor : public juce::AudioProcessor
-{
-  public:
-    //==============================================================================
-    PluginProcessor();
-    ~PluginProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
-#endif
-
-    void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram(int index) override;
-    const juce::String getProgramName(int index) override;
-    void changeProgramName(int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation(juce::MemoryBlock& destData) override;
-    void setStateInformation(const void* data, int sizeInBytes) override;
-
-    bool isAudioBufferReady(uint32_t channel);
-    void copyAudioBuffer(std::vector<float>& destination, uint32_t channel);
-
-    bool isSpectrumReady();
-    void copySpectrum(std::vector<std::vector<Polar>>& destination);
-
-  private:
-    std::vector<CircularBuffer<float>> m_circularAudioBuffers;
-    FFTBuffer m_fftBuffer;
-
-    std::atomic<float>* p_bands = nullptr;
-    std::atomic<float>* p_position = nullptr;
-    std::atomic<float>* p_width = nullptr;
-    std::atomic<float>* p_offset = nullptr;
-    std::atomic<float>* p_bias = nullptr;
-    std::atomic<float>* p_makeup = nullptr;
-
-    std::atomic<bool> m_isSpectrumReady = false;
-    std::vector<std::vector<float>> m_prevAudioBuffer;
-    std::vector<std::vector<Polar>> m_prevSpectrum;
-
-    std::mutex m_readWriteAudioBufferLock;
-    std::mutex m_readWriteSpectrumLock;
-
-    void processFFT(std::complex<float>* fftData, unsigned int channel);
-
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginProcessor)
-
-    juce::AudioProcessorValueTreeState m_params;
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "CircularBuffer.h"
+#include "FFTBuffer.h"
+#include "RealtimeWorkerPool.h"
+#include "TripleBuffer.h"
+
+// snapshot of the parameters that shape the spectral gain curve
+struct SpectralParameters
+{
+    float bands;
+    float position;
+    float width;
+    float offset;
+    float bias;
+    float makeup;
+
+    bool operator==(const SpectralParameters& rhs) const;
+    bool operator!=(const SpectralParameters& rhs) const;
+};
+
+// what the analysis publishes for each bin
+enum class SpectrumScale
+{
+    magnitude,
+    power,
+};
+
+enum
+{
+    MIN_FFT_ORDER = 8,
+    MAX_FFT_ORDER = 14,
+    DEFAULT_FFT_ORDER = 12,
+    // a 7.1.4 bed
+    MAX_CHANNELS = 12,
+};
+
+//==============================================================================
+/**
+ */
+class PluginProcessor
+  : public juce::AudioProcessor
+  , private juce::AsyncUpdater
+{
+  public:
+    //==============================================================================
+    PluginProcessor();
+    ~PluginProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
+#endif
+
+    void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram(int index) override;
+    const juce::String getProgramName(int index) override;
+    void changeProgramName(int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+    bool isAudioBufferReady(uint32_t channel);
+    bool copyAudioBuffer(std::vector<float>& destination, uint32_t channel);
+
+    // spectrum analysis only runs between these calls, at no more than maxFrameRate frames per second and channel;
+    // while nobody has asked for it the audio thread skips it entirely
+    void startAnalysis(double maxFrameRate, SpectrumScale scale = SpectrumScale::magnitude);
+    void stopAnalysis();
+
+    // copies the latest complete frame of every channel, resizing destination to the channel count; returns true if
+    // any of them is newer than the last copy
+    bool copySpectrum(std::vector<std::vector<float>>& destination);
+
+    // whether this instance may join the process-wide worker pool; a host that already runs instances side by side on
+    // every core, such as the batch renderer, turns it off before the first prepareToPlay() so no core is asked twice
+    void setUsesWorkerPool(bool shouldUseWorkerPool);
+
+  private:
+    // times processFFT on its own
+    friend class EngineBenchmarks;
+
+    struct SpectralEngine;
+
+    // hands each frame back to processFFT; passed to the engine by type so the call is resolved statically
+    struct FrameProcessor
+    {
+        PluginProcessor& owner;
+        SpectralEngine& engine;
+
+        void operator()(std::complex<float>* fftData, unsigned int channel) const { owner.processFFT(engine, fftData, channel); }
+    };
+
+    // everything that follows the FFT size and overlap; built on the message thread and swapped in whole
+    struct SpectralEngine
+    {
+        SpectralEngine(
+            PluginProcessor& owner, unsigned numChannels, unsigned fftOrder, unsigned numOverlaps, FFTBuffer::Scheduling scheduling, int maxBlockSize);
+
+        bool isConfiguredFor(unsigned channels, unsigned order, unsigned overlaps) const;
+
+        const unsigned numChannels;
+        const unsigned fftOrder;
+        const unsigned fftSize;
+        const unsigned numBins;
+        const unsigned numOverlaps;
+
+        FFTBuffer fftBuffer;
+
+        // per-channel gain for each non-negative bin, rebuilt only when the parameter snapshot changes; channels may be
+        // processed on different threads at once, so each flag is a byte of its own rather than a bit of vector<bool>
+        std::vector<std::vector<float>> gainTables;
+        std::vector<SpectralParameters> gainTableParameters;
+        std::vector<char> isGainTableValid;
+
+        // one wait-free hand-off per channel, since each channel's frames may be produced on a different thread
+        std::vector<std::unique_ptr<TripleBuffer<std::vector<float>>>> spectrum;
+
+        // counts down between analysed frames; only touched by whichever thread processes the channel
+        std::vector<double> samplesUntilAnalysis;
+
+        // while incoming, the engine runs on a copy of the input, a block at most at a time, until it has seen enough of
+        // it for its output to be what a running engine's would be
+        juce::AudioBuffer<float> warmUpBuffer;
+        int numWarmUpSamples;
+    };
+
+    std::vector<CircularBuffer<float>> m_circularAudioBuffers;
+
+    // the process-wide pool, joined the first time a layout is wide enough or a render is offline, and held until destruction
+    std::unique_ptr<juce::SharedResourcePointer<RealtimeWorkerPool>> m_workerPool;
+    bool m_usesWorkerPool = true;
+
+    // the audio thread only ever swaps pointers; allocation and deletion both happen on the message thread. a pending
+    // engine is taken by the audio thread and warmed up as the incoming one, then swapped in and the old one retired
+    std::atomic<SpectralEngine*> m_engine = nullptr;
+    std::atomic<SpectralEngine*> m_pendingEngine = nullptr;
+    std::atomic<SpectralEngine*> m_incomingEngine = nullptr;
+    std::atomic<SpectralEngine*> m_retiredEngine = nullptr;
+
+    std::atomic<float>* p_bands = nullptr;
+    std::atomic<float>* p_position = nullptr;
+    std::atomic<float>* p_width = nullptr;
+    std::atomic<float>* p_offset = nullptr;
+    std::atomic<float>* p_bias = nullptr;
+    std::atomic<float>* p_makeup = nullptr;
+    std::atomic<float>* p_scheduling = nullptr;
+    std::atomic<float>* p_fftSize = nullptr;
+    std::atomic<float>* p_overlap = nullptr;
+
+    // zero while analysis is stopped
+    std::atomic<double> m_analysisFrameRate = 0.0;
+    std::atomic<SpectrumScale> m_analysisScale = SpectrumScale::magnitude;
+
+    // a latency the audio thread has switched to, for the message thread to report; negative once reported
+    std::atomic<int> m_pendingLatencySamples = -1;
+
+    // keeps prepareToPlay from replacing the engine while copySpectrum reads it; the audio thread never takes it
+    std::mutex m_engineLock;
+
+    FFTBuffer::Scheduling getRequestedScheduling() const;
+    unsigned getRequestedFFTOrder() const;
+    unsigned getRequestedNumOverlaps() const;
+    unsigned getRequestedNumChannels() const;
+    void prepareWorkerPool(unsigned numChannels);
+    RealtimeWorkerPool* getWorkerPool() const;
+    void updateScheduling(SpectralEngine& engine);
+    SpectralEngine* getIncomingEngine();
+    void runIncomingEngine(SpectralEngine& engine, SpectralEngine& incoming, juce::AudioBuffer<float>& buffer);
+    void swapEngine(SpectralEngine* engine);
+    void reportLatency(const SpectralEngine& engine);
+    void handleAsyncUpdate() override;
+
+    SpectralParameters getSpectralParameters() const;
+    void updateGainTable(SpectralEngine& engine, const SpectralParameters& parameters, unsigned int channel);
+    void applyGainTable(SpectralEngine& engine, std::complex<float>* fftData, unsigned int channel);
+    void analyseFrame(SpectralEngine& engine, const std::complex<float>* fftData, unsigned int channel);
+    void processFFT(SpectralEngine& engine, std::complex<float>* fftData, unsigned int channel);
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginProcessor)
+
+    juce::AudioProcessorValueTreeState m_params;
+};
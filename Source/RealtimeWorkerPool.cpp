@@ -0,0 +1,185 @@
+#include "RealtimeWorkerPool.h"
+
+#include "ScopedNoAllocation.h"
+#include "WakeUpSignal.h"
+
+class RealtimeWorkerPool::Worker : public juce::Thread
+{
+  public:
+    Worker(RealtimeWorkerPool& owner)
+      : juce::Thread("RealtimeWorkerPool worker")
+      , m_owner(owner)
+    {
+    }
+
+    ~Worker() override
+    {
+        this->signalThreadShouldExit();
+        m_wakeUp.signal();
+        this->stopThread(1000);
+    }
+
+    void wakeUp() { m_wakeUp.signal(); }
+
+    void run() override
+    {
+        // keeps stealing while there is anything to steal, and sleeps once a whole pass finds nothing; a batch
+        // published during the pass wakes it before it sleeps, and is stolen on the next one
+        while (!this->threadShouldExit()) {
+            m_wakeUp.reset();
+
+            if (!m_owner.stealJobs()) {
+                m_wakeUp.wait(100);
+            }
+        }
+    }
+
+  private:
+    RealtimeWorkerPool& m_owner;
+    WakeUpSignal m_wakeUp;
+};
+
+std::atomic<int> RealtimeWorkerPool::s_defaultNumWorkers = -1;
+
+RealtimeWorkerPool::RealtimeWorkerPool()
+  : RealtimeWorkerPool(getDefaultNumWorkers())
+{
+}
+
+RealtimeWorkerPool::RealtimeWorkerPool(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i) {
+        m_workers.push_back(std::make_unique<Worker>(*this));
+        m_workers.back()->startRealtimeThread();
+    }
+}
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    m_workers.clear();
+}
+
+int RealtimeWorkerPool::getNumWorkers() const
+{
+    return static_cast<int>(m_workers.size());
+}
+
+void RealtimeWorkerPool::setDefaultNumWorkers(int numWorkers)
+{
+    s_defaultNumWorkers = numWorkers;
+}
+
+int RealtimeWorkerPool::getDefaultNumWorkers()
+{
+    const int numWorkers = s_defaultNumWorkers;
+    return numWorkers >= 0 ? numWorkers : juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+}
+
+void RealtimeWorkerPool::runBatch(Job job, void* context, int numJobs)
+{
+    const ScopedNoAllocation noAllocation;
+
+    Batch batch;
+    batch.job = job;
+    batch.context = context;
+    batch.numJobs = numJobs;
+
+    Slot* slot = numJobs > 1 ? this->publishBatch(batch) : nullptr;
+
+    if (slot != nullptr) {
+        this->wakeWorkers(numJobs - 1);
+    }
+
+    runJobs(batch);
+
+    if (slot == nullptr) {
+        return;
+    }
+
+    while (batch.numFinished.load() < numJobs) {
+        std::this_thread::yield();
+    }
+
+    // a worker that found the batch may still be about to claim from it; it has to be gone before the stack unwinds
+    slot->batch.store(nullptr);
+
+    while (slot->numReaders.load() > 0) {
+        std::this_thread::yield();
+    }
+}
+
+// callers start at different slots so they rarely contend for the same one
+RealtimeWorkerPool::Slot* RealtimeWorkerPool::publishBatch(Batch& batch)
+{
+    const unsigned firstSlot = m_nextSlot++;
+
+    for (unsigned i = 0; i < MAX_PUBLISHED_BATCHES; ++i) {
+        auto& slot = m_slots[(firstSlot + i) % MAX_PUBLISHED_BATCHES];
+        Batch* expected = nullptr;
+
+        if (slot.batch.compare_exchange_strong(expected, &batch)) {
+            return &slot;
+        }
+    }
+
+    return nullptr;
+}
+
+// the caller takes one job itself, so only the rest need a worker; rotating the start spreads the wake-ups
+void RealtimeWorkerPool::wakeWorkers(int numJobs)
+{
+    const int numWorkers = this->getNumWorkers();
+    const int numToWake = juce::jmin(numJobs, numWorkers);
+
+    if (numToWake <= 0) {
+        return;
+    }
+
+    const unsigned firstWorker = m_nextWorker.fetch_add(static_cast<unsigned>(numToWake));
+
+    for (int i = 0; i < numToWake; ++i) {
+        m_workers[(firstWorker + static_cast<unsigned>(i)) % static_cast<unsigned>(numWorkers)]->wakeUp();
+    }
+}
+
+// called on a worker; returns whether any job was run
+bool RealtimeWorkerPool::stealJobs()
+{
+    const ScopedNoAllocation noAllocation;
+
+    bool isAnyJobRun = false;
+
+    for (auto& slot : m_slots) {
+        if (slot.batch.load() == nullptr) {
+            continue;
+        }
+
+        // the batch is loaded again once this worker is counted, since its caller may have withdrawn it meanwhile
+        ++slot.numReaders;
+
+        if (auto* batch = slot.batch.load()) {
+            isAnyJobRun |= runJobs(*batch);
+        }
+
+        --slot.numReaders;
+    }
+
+    return isAnyJobRun;
+}
+
+bool RealtimeWorkerPool::runJobs(Batch& batch)
+{
+    bool isAnyJobRun = false;
+
+    for (;;) {
+        const int index = batch.nextJob.fetch_add(1);
+
+        if (index >= batch.numJobs) {
+            return isAnyJobRun;
+        }
+
+        batch.job(batch.context, index);
+        ++batch.numFinished;
+        isAnyJobRun = true;
+    }
+}
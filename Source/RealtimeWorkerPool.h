@@ -0,0 +1,82 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// realtime threads shared by every instance in the process, reached through juce::SharedResourcePointer so the pool
+// starts with the first instance that asks for it and stops with the last one to let go; each caller publishes its
+// batch of independent jobs, works through it alongside whichever idle workers steal from it, and only returns once
+// every job has finished, so a batch never outlives the block that started it
+//
+// it spreads work within one instance's block: the channels of any layout wider than mono, in the blocks that have
+// transform work in them, and the batched frames of an offline render. a host thread running many stereo instances
+// one after another so hands one channel of each instance's frames to a worker while it runs the other itself
+class RealtimeWorkerPool
+{
+  public:
+    // one worker for every core besides the caller's, unless setDefaultNumWorkers() says otherwise
+    RealtimeWorkerPool();
+    explicit RealtimeWorkerPool(int numWorkers);
+    ~RealtimeWorkerPool();
+
+    int getNumWorkers() const;
+
+    // how many workers pools made from here on by the default constructor start, and so the shared one the next time it
+    // starts; a negative count goes back to one per core besides the caller's. for benchmarks that scale the pool
+    static void setDefaultNumWorkers(int numWorkers);
+    static int getDefaultNumWorkers();
+
+    // calls function(index) once for every index below numJobs, in no particular order and on any of the threads;
+    // nothing is allocated, so it may be called from the audio thread, and from any number of them at once
+    template<typename Function>
+    void run(int numJobs, Function& function);
+
+  private:
+    class Worker;
+
+    using Job = void (*)(void* context, int index);
+
+    // one caller's jobs; lives on the caller's stack for the duration of run()
+    struct Batch
+    {
+        Job job;
+        void* context;
+        int numJobs;
+
+        std::atomic<int> nextJob = 0;
+        std::atomic<int> numFinished = 0;
+    };
+
+    // where a batch is published; the workers reading it are counted so its caller can wait them out before returning
+    struct Slot
+    {
+        std::atomic<Batch*> batch = nullptr;
+        std::atomic<int> numReaders = 0;
+    };
+
+    enum
+    {
+        // callers beyond this many at once run their batch alone
+        MAX_PUBLISHED_BATCHES = 64,
+    };
+
+    std::array<Slot, MAX_PUBLISHED_BATCHES> m_slots;
+    std::atomic<unsigned> m_nextSlot = 0;
+    std::atomic<unsigned> m_nextWorker = 0;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    static std::atomic<int> s_defaultNumWorkers;
+
+    void runBatch(Job job, void* context, int numJobs);
+    Slot* publishBatch(Batch& batch);
+    void wakeWorkers(int numJobs);
+    bool stealJobs();
+
+    static bool runJobs(Batch& batch);
+};
+
+template<typename Function>
+void RealtimeWorkerPool::run(int numJobs, Function& function)
+{
+    this->runBatch([](void* context, int index) { (*static_cast<Function*>(context))(index); }, &function, numJobs);
+}
@@ -0,0 +1,222 @@
+#include "ScopedNoAllocation.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#if JUCE_DEBUG
+
+static thread_local int s_noAllocationDepth = 0;
+
+ScopedNoAllocation::ScopedNoAllocation()
+{
+    ++s_noAllocationDepth;
+}
+
+ScopedNoAllocation::~ScopedNoAllocation()
+{
+    --s_noAllocationDepth;
+}
+
+bool ScopedNoAllocation::isActive()
+{
+    return s_noAllocationDepth > 0;
+}
+
+#endif
+
+#if JUCE_DEBUG || FOURIER_FILTER_COUNT_ALLOCATIONS
+
+static std::atomic<juce::int64> s_numAllocations = 0;
+
+juce::int64 ScopedNoAllocation::getNumAllocations()
+{
+    return s_numAllocations.load(std::memory_order_relaxed);
+}
+
+// called for every allocation the build sees
+static void noteAllocation()
+{
+#if JUCE_DEBUG
+    if (s_noAllocationDepth > 0) {
+        // the assertion handler may allocate itself, so lift the restriction while it runs
+        const int depth = std::exchange(s_noAllocationDepth, 0);
+
+        // heap allocation inside a real-time section
+        jassertfalse;
+
+        s_noAllocationDepth = depth;
+    }
+#endif
+
+    s_numAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void* allocateChecked(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+{
+#if !FOURIER_FILTER_COUNT_MALLOC
+    // otherwise the replaced malloc below notes it
+    noteAllocation();
+#endif
+
+    size = juce::jmax<std::size_t>(size, 1);
+
+    // aligned_alloc wants a whole number of alignments
+    void* memory = alignment <= alignof(std::max_align_t) ? std::malloc(size) : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void* operator new(std::size_t size)
+{
+    return allocateChecked(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocateChecked(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateChecked(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocateChecked(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+#endif
+
+#if FOURIER_FILTER_COUNT_MALLOC
+
+// glibc's own implementations, which it exports so that a replacement can forward to them; the replacements below are
+// the ones the whole process links against, JUCE and the C++ runtime included
+extern "C"
+{
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* memory, std::size_t size);
+    void* __libc_memalign(std::size_t alignment, std::size_t size);
+    void* __libc_valloc(std::size_t size);
+    void* __libc_pvalloc(std::size_t size);
+    void __libc_free(void* memory);
+
+    void* malloc(std::size_t size) noexcept
+    {
+        noteAllocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size) noexcept
+    {
+        noteAllocation();
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* memory, std::size_t size) noexcept
+    {
+        // resizing to nothing frees rather than allocates
+        if (memory == nullptr || size > 0) {
+            noteAllocation();
+        }
+
+        return __libc_realloc(memory, size);
+    }
+
+    void* memalign(std::size_t alignment, std::size_t size) noexcept
+    {
+        noteAllocation();
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+    {
+        noteAllocation();
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** memory, std::size_t alignment, std::size_t size) noexcept
+    {
+        if (alignment % sizeof(void*) != 0 || !juce::isPowerOfTwo(alignment)) {
+            return EINVAL;
+        }
+
+        noteAllocation();
+        void* aligned = __libc_memalign(alignment, size);
+
+        if (aligned == nullptr) {
+            return ENOMEM;
+        }
+
+        *memory = aligned;
+        return 0;
+    }
+
+    void* valloc(std::size_t size) noexcept
+    {
+        noteAllocation();
+        return __libc_valloc(size);
+    }
+
+    void* pvalloc(std::size_t size) noexcept
+    {
+        noteAllocation();
+        return __libc_pvalloc(size);
+    }
+
+    // glibc only supports replacing malloc along with free
+    void free(void* memory) noexcept
+    {
+        __libc_free(memory);
+    }
+}
+
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// tools such as the benchmarks define this to have release builds count allocations too
+#ifndef FOURIER_FILTER_COUNT_ALLOCATIONS
+#define FOURIER_FILTER_COUNT_ALLOCATIONS 0
+#endif
+
+// the counting build also replaces malloc and its relatives where the C library lets them be forwarded to its own, so
+// that JUCE's HeapBlock and everything else built on them is counted as well; only glibc does
+#if FOURIER_FILTER_COUNT_ALLOCATIONS && JUCE_LINUX && defined(__GLIBC__)
+#define FOURIER_FILTER_COUNT_MALLOC 1
+#else
+#define FOURIER_FILTER_COUNT_MALLOC 0
+#endif
+
+// marks a scope on the calling thread in which the heap must not be touched;
+// debug builds replace the global operator new and assert when it is called inside one
+class ScopedNoAllocation
+{
+  public:
+#if JUCE_DEBUG
+    ScopedNoAllocation();
+    ~ScopedNoAllocation();
+
+    static bool isActive();
+#else
+    ScopedNoAllocation() = default;
+
+    static bool isActive() { return false; }
+#endif
+
+#if JUCE_DEBUG || FOURIER_FILTER_COUNT_ALLOCATIONS
+    // every heap allocation so far, on any thread; counted by the replaced operator new, and by the replaced C allocation
+    // functions where countedAllocators says so
+    static juce::int64 getNumAllocations();
+    static constexpr bool countsAllocations = true;
+#else
+    static juce::int64 getNumAllocations() { return 0; }
+    static constexpr bool countsAllocations = false;
+#endif
+
+    // what getNumAllocations() sees; an allocation made any other way goes uncounted
+    static constexpr const char* countedAllocators = FOURIER_FILTER_COUNT_MALLOC ? "operator new and the C allocation functions"
+                                                     : countsAllocations        ? "operator new only, not malloc, calloc or realloc"
+                                                                                : "none";
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedNoAllocation)
+};
@@ -0,0 +1,366 @@
+#include "SpectralKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SPECTRAL_KERNELS_X64 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SPECTRAL_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// every kernel rounds each product on its own, as the vector lanes do; left to themselves, compilers fuse a * b + c * d
+// into a multiply-add wherever the target has one, which includes every aarch64 build, and the scalar reference would
+// then round differently from the vector implementations
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#if SPECTRAL_KERNELS_X64 && (defined(__GNUC__) || defined(__clang__))
+#define SPECTRAL_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SPECTRAL_KERNELS_TARGET_AVX2
+#endif
+
+namespace
+{
+    struct KernelTable
+    {
+        void (*multiply)(float*, const float*, const float*, int);
+        void (*add)(float*, const float*, int);
+        void (*multiplyBins)(float*, const float*, int);
+        void (*binPowers)(float*, const float*, int);
+        void (*binMagnitudes)(float*, const float*, int);
+    };
+
+    void multiplyScalar(float* destination, const float* source, const float* window, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i) {
+            destination[i] = source[i] * window[i];
+        }
+    }
+
+    void addScalar(float* destination, const float* source, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i) {
+            destination[i] += source[i];
+        }
+    }
+
+    void multiplyBinsScalar(float* bins, const float* gains, int numBins)
+    {
+        for (int i = 0; i < numBins; ++i) {
+            bins[2 * i] *= gains[i];
+            bins[2 * i + 1] *= gains[i];
+        }
+    }
+
+    template<bool IsMagnitude>
+    void binLevelsScalar(float* destination, const float* bins, int numBins)
+    {
+        for (int i = 0; i < numBins; ++i) {
+            const float power = bins[2 * i] * bins[2 * i] + bins[2 * i + 1] * bins[2 * i + 1];
+            destination[i] = IsMagnitude ? std::sqrt(power) : power;
+        }
+    }
+
+    const KernelTable scalarKernels = { multiplyScalar, addScalar, multiplyBinsScalar, binLevelsScalar<false>, binLevelsScalar<true> };
+
+#if SPECTRAL_KERNELS_X64
+    void multiplySSE2(float* destination, const float* source, const float* window, int numSamples)
+    {
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4) {
+            _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_loadu_ps(source + i), _mm_loadu_ps(window + i)));
+        }
+
+        multiplyScalar(destination + i, source + i, window + i, numSamples - i);
+    }
+
+    void addSSE2(float* destination, const float* source, int numSamples)
+    {
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4) {
+            _mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), _mm_loadu_ps(source + i)));
+        }
+
+        addScalar(destination + i, source + i, numSamples - i);
+    }
+
+    void multiplyBinsSSE2(float* bins, const float* gains, int numBins)
+    {
+        int i = 0;
+
+        for (; i + 4 <= numBins; i += 4) {
+            // duplicate each gain so it lines up with the real and imaginary part of its bin
+            const __m128 gain = _mm_loadu_ps(gains + i);
+            const __m128 gainLow = _mm_unpacklo_ps(gain, gain);
+            const __m128 gainHigh = _mm_unpackhi_ps(gain, gain);
+
+            float* binData = bins + 2 * i;
+            _mm_storeu_ps(binData, _mm_mul_ps(_mm_loadu_ps(binData), gainLow));
+            _mm_storeu_ps(binData + 4, _mm_mul_ps(_mm_loadu_ps(binData + 4), gainHigh));
+        }
+
+        multiplyBinsScalar(bins + 2 * i, gains + i, numBins - i);
+    }
+
+    template<bool IsMagnitude>
+    void binLevelsSSE2(float* destination, const float* bins, int numBins)
+    {
+        int i = 0;
+
+        for (; i + 4 <= numBins; i += 4) {
+            const __m128 binsLow = _mm_loadu_ps(bins + 2 * i);
+            const __m128 binsHigh = _mm_loadu_ps(bins + 2 * i + 4);
+
+            // squares first, then the even and odd lanes are the real and imaginary parts of four bins
+            const __m128 squaresLow = _mm_mul_ps(binsLow, binsLow);
+            const __m128 squaresHigh = _mm_mul_ps(binsHigh, binsHigh);
+            const __m128 power = _mm_add_ps(_mm_shuffle_ps(squaresLow, squaresHigh, _MM_SHUFFLE(2, 0, 2, 0)),
+                                            _mm_shuffle_ps(squaresLow, squaresHigh, _MM_SHUFFLE(3, 1, 3, 1)));
+
+            _mm_storeu_ps(destination + i, IsMagnitude ? _mm_sqrt_ps(power) : power);
+        }
+
+        binLevelsScalar<IsMagnitude>(destination + i, bins + 2 * i, numBins - i);
+    }
+
+    const KernelTable sse2Kernels = { multiplySSE2, addSSE2, multiplyBinsSSE2, binLevelsSSE2<false>, binLevelsSSE2<true> };
+
+    SPECTRAL_KERNELS_TARGET_AVX2 void multiplyAVX2(float* destination, const float* source, const float* window, int numSamples)
+    {
+        int i = 0;
+
+        for (; i + 8 <= numSamples; i += 8) {
+            _mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_loadu_ps(source + i), _mm256_loadu_ps(window + i)));
+        }
+
+        multiplyScalar(destination + i, source + i, window + i, numSamples - i);
+    }
+
+    SPECTRAL_KERNELS_TARGET_AVX2 void addAVX2(float* destination, const float* source, int numSamples)
+    {
+        int i = 0;
+
+        for (; i + 8 <= numSamples; i += 8) {
+            _mm256_storeu_ps(destination + i, _mm256_add_ps(_mm256_loadu_ps(destination + i), _mm256_loadu_ps(source + i)));
+        }
+
+        addScalar(destination + i, source + i, numSamples - i);
+    }
+
+    SPECTRAL_KERNELS_TARGET_AVX2 void multiplyBinsAVX2(float* bins, const float* gains, int numBins)
+    {
+        int i = 0;
+
+        for (; i + 8 <= numBins; i += 8) {
+            // unpack works within 128-bit lanes, so the halves are stitched back into bin order afterwards
+            const __m256 gain = _mm256_loadu_ps(gains + i);
+            const __m256 gainLow = _mm256_unpacklo_ps(gain, gain);
+            const __m256 gainHigh = _mm256_unpackhi_ps(gain, gain);
+
+            float* binData = bins + 2 * i;
+            _mm256_storeu_ps(binData, _mm256_mul_ps(_mm256_loadu_ps(binData), _mm256_permute2f128_ps(gainLow, gainHigh, 0x20)));
+            _mm256_storeu_ps(binData + 8, _mm256_mul_ps(_mm256_loadu_ps(binData + 8), _mm256_permute2f128_ps(gainLow, gainHigh, 0x31)));
+        }
+
+        multiplyBinsSSE2(bins + 2 * i, gains + i, numBins - i);
+    }
+
+    template<bool IsMagnitude>
+    SPECTRAL_KERNELS_TARGET_AVX2 void binLevelsAVX2(float* destination, const float* bins, int numBins)
+    {
+        int i = 0;
+
+        for (; i + 8 <= numBins; i += 8) {
+            const __m256 binsLow = _mm256_loadu_ps(bins + 2 * i);
+            const __m256 binsHigh = _mm256_loadu_ps(bins + 2 * i + 8);
+
+            const __m256 squaresLow = _mm256_mul_ps(binsLow, binsLow);
+            const __m256 squaresHigh = _mm256_mul_ps(binsHigh, binsHigh);
+            const __m256 power = _mm256_add_ps(_mm256_shuffle_ps(squaresLow, squaresHigh, _MM_SHUFFLE(2, 0, 2, 0)),
+                                               _mm256_shuffle_ps(squaresLow, squaresHigh, _MM_SHUFFLE(3, 1, 3, 1)));
+
+            // the in-lane shuffles leave bins ordered 0 1 4 5 2 3 6 7, so the middle pairs are swapped back
+            const __m256 ordered = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(power), _MM_SHUFFLE(3, 1, 2, 0)));
+
+            _mm256_storeu_ps(destination + i, IsMagnitude ? _mm256_sqrt_ps(ordered) : ordered);
+        }
+
+        binLevelsSSE2<IsMagnitude>(destination + i, bins + 2 * i, numBins - i);
+    }
+
+    const KernelTable avx2Kernels = { multiplyAVX2, addAVX2, multiplyBinsAVX2, binLevelsAVX2<false>, binLevelsAVX2<true> };
+#endif
+
+#if SPECTRAL_KERNELS_NEON
+    void multiplyNeon(float* destination, const float* source, const float* window, int numSamples)
+    {
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4) {
+            vst1q_f32(destination + i, vmulq_f32(vld1q_f32(source + i), vld1q_f32(window + i)));
+        }
+
+        multiplyScalar(destination + i, source + i, window + i, numSamples - i);
+    }
+
+    void addNeon(float* destination, const float* source, int numSamples)
+    {
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4) {
+            vst1q_f32(destination + i, vaddq_f32(vld1q_f32(destination + i), vld1q_f32(source + i)));
+        }
+
+        addScalar(destination + i, source + i, numSamples - i);
+    }
+
+    void multiplyBinsNeon(float* bins, const float* gains, int numBins)
+    {
+        int i = 0;
+
+        for (; i + 4 <= numBins; i += 4) {
+            const float32x4_t gain = vld1q_f32(gains + i);
+            const float32x4x2_t gainPairs = vzipq_f32(gain, gain);
+
+            float* binData = bins + 2 * i;
+            vst1q_f32(binData, vmulq_f32(vld1q_f32(binData), gainPairs.val[0]));
+            vst1q_f32(binData + 4, vmulq_f32(vld1q_f32(binData + 4), gainPairs.val[1]));
+        }
+
+        multiplyBinsScalar(bins + 2 * i, gains + i, numBins - i);
+    }
+
+    template<bool IsMagnitude>
+    void binLevelsNeon(float* destination, const float* bins, int numBins)
+    {
+        int i = 0;
+
+        for (; i + 4 <= numBins; i += 4) {
+            // the structured load splits real and imaginary parts into separate registers
+            const float32x4x2_t parts = vld2q_f32(bins + 2 * i);
+            const float32x4_t power = vaddq_f32(vmulq_f32(parts.val[0], parts.val[0]), vmulq_f32(parts.val[1], parts.val[1]));
+
+            vst1q_f32(destination + i, IsMagnitude ? vsqrtq_f32(power) : power);
+        }
+
+        binLevelsScalar<IsMagnitude>(destination + i, bins + 2 * i, numBins - i);
+    }
+
+    const KernelTable neonKernels = { multiplyNeon, addNeon, multiplyBinsNeon, binLevelsNeon<false>, binLevelsNeon<true> };
+#endif
+
+    const KernelTable& getTable(SpectralKernels::Implementation implementation)
+    {
+        switch (implementation) {
+#if SPECTRAL_KERNELS_X64
+            case SpectralKernels::Implementation::sse2:
+                return sse2Kernels;
+            case SpectralKernels::Implementation::avx2:
+                return avx2Kernels;
+#endif
+#if SPECTRAL_KERNELS_NEON
+            case SpectralKernels::Implementation::neon:
+                return neonKernels;
+#endif
+            default:
+                return scalarKernels;
+        }
+    }
+
+    SpectralKernels::Implementation getBestImplementation()
+    {
+        for (auto implementation : { SpectralKernels::Implementation::avx2, SpectralKernels::Implementation::neon, SpectralKernels::Implementation::sse2 }) {
+            if (SpectralKernels::isAvailable(implementation)) {
+                return implementation;
+            }
+        }
+
+        return SpectralKernels::Implementation::scalar;
+    }
+
+    std::atomic<SpectralKernels::Implementation> s_implementation{ getBestImplementation() };
+    std::atomic<const KernelTable*> s_kernels{ &getTable(s_implementation.load()) };
+}
+
+namespace SpectralKernels
+{
+    Implementation getImplementation()
+    {
+        return s_implementation.load();
+    }
+
+    void setImplementation(Implementation implementation)
+    {
+        jassert(isAvailable(implementation));
+
+        s_implementation.store(implementation);
+        s_kernels.store(&getTable(implementation));
+    }
+
+    bool isAvailable(Implementation implementation)
+    {
+        switch (implementation) {
+            case Implementation::scalar:
+                return true;
+#if SPECTRAL_KERNELS_X64
+            case Implementation::sse2:
+                return true;
+            case Implementation::avx2:
+                return juce::SystemStats::hasAVX2();
+#endif
+#if SPECTRAL_KERNELS_NEON
+            case Implementation::neon:
+                return true;
+#endif
+            default:
+                return false;
+        }
+    }
+
+    const char* getName(Implementation implementation)
+    {
+        switch (implementation) {
+            case Implementation::sse2:
+                return "sse2";
+            case Implementation::avx2:
+                return "avx2";
+            case Implementation::neon:
+                return "neon";
+            default:
+                return "scalar";
+        }
+    }
+
+    void multiply(float* destination, const float* source, const float* window, int numSamples)
+    {
+        s_kernels.load(std::memory_order_relaxed)->multiply(destination, source, window, numSamples);
+    }
+
+    void add(float* destination, const float* source, int numSamples)
+    {
+        s_kernels.load(std::memory_order_relaxed)->add(destination, source, numSamples);
+    }
+
+    void multiplyBins(std::complex<float>* bins, const float* gains, int numBins)
+    {
+        s_kernels.load(std::memory_order_relaxed)->multiplyBins(reinterpret_cast<float*>(bins), gains, numBins);
+    }
+
+    void binPowers(float* destination, const std::complex<float>* bins, int numBins)
+    {
+        s_kernels.load(std::memory_order_relaxed)->binPowers(destination, reinterpret_cast<const float*>(bins), numBins);
+    }
+
+    void binMagnitudes(float* destination, const std::complex<float>* bins, int numBins)
+    {
+        s_kernels.load(std::memory_order_relaxed)->binMagnitudes(destination, reinterpret_cast<const float*>(bins), numBins);
+    }
+}
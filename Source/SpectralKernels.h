@@ -0,0 +1,37 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// vectorized inner loops of the spectral engine; every implementation produces results identical
+// to the scalar reference, since each lane performs the same single IEEE operation
+namespace SpectralKernels
+{
+    enum class Implementation
+    {
+        scalar,
+        sse2,
+        avx2,
+        neon,
+    };
+
+    // the fastest implementation the running CPU supports is selected during static initialisation, as the code loads
+    Implementation getImplementation();
+    void setImplementation(Implementation implementation);
+    bool isAvailable(Implementation implementation);
+    const char* getName(Implementation implementation);
+
+    // destination[i] = source[i] * window[i]
+    void multiply(float* destination, const float* source, const float* window, int numSamples);
+
+    // destination[i] += source[i]
+    void add(float* destination, const float* source, int numSamples);
+
+    // scales each interleaved complex bin by its real gain
+    void multiplyBins(std::complex<float>* bins, const float* gains, int numBins);
+
+    // destination[i] = |bins[i]|^2
+    void binPowers(float* destination, const std::complex<float>* bins, int numBins);
+
+    // destination[i] = |bins[i]|, as the square root of the power rather than std::abs's overflow-safe hypot
+    void binMagnitudes(float* destination, const std::complex<float>* bins, int numBins);
+}
@@ -0,0 +1,95 @@
+#include "SpectrogramView.h"
+
+SpectrogramView::SpectrogramView()
+{
+    // from the editor background through the channel colours to near black
+    const juce::Colour stops[] = { juce::Colour(0xfff6efe4), juce::Colour(0xff444372), juce::Colour(0xff744342), juce::Colour(0xff1a1014) };
+    const int numSegments = static_cast<int>(std::size(stops)) - 1;
+
+    for (int i = 0; i < COLOUR_MAP_SIZE; ++i) {
+        const float position = static_cast<float>(i) / (COLOUR_MAP_SIZE - 1) * static_cast<float>(numSegments);
+        const int segment = juce::jmin(static_cast<int>(position), numSegments - 1);
+
+        m_colourMap[static_cast<size_t>(i)] = stops[segment].interpolatedWith(stops[segment + 1], position - static_cast<float>(segment)).getPixelARGB();
+    }
+
+    this->setOpaque(true);
+}
+
+void SpectrogramView::setHistoryDepth(int numFrames)
+{
+    jassert(numFrames > 0);
+
+    m_historyDepth = juce::jmax(1, numFrames);
+    this->resetHistory();
+}
+
+int SpectrogramView::getHistoryDepth() const
+{
+    return m_historyDepth;
+}
+
+void SpectrogramView::resized()
+{
+    this->resetHistory();
+}
+
+void SpectrogramView::resetHistory()
+{
+    const int numRows = juce::jmax(1, this->getHeight());
+
+    m_history = juce::Image(juce::Image::ARGB, m_historyDepth, numRows, false);
+
+    juce::Graphics historyGraphics(m_history);
+    historyGraphics.fillAll(juce::Colour(m_colourMap[0].getNativeARGB()));
+
+    m_writeColumn = 0;
+    m_levels.resize(static_cast<size_t>(numRows));
+}
+
+void SpectrogramView::pushFrame(const std::vector<std::vector<float>>& spectra, double sampleRate)
+{
+    if (spectra.empty()) {
+        return;
+    }
+
+    const int numRows = m_history.getHeight();
+
+    m_renderer.prepare(juce::Rectangle<int>(0, 0, numRows, 1), sampleRate, static_cast<int>(spectra[0].size()));
+    std::fill(m_levels.begin(), m_levels.end(), 0.f);
+
+    for (const auto& spectrum : spectra) {
+        m_renderer.computeLevels(spectrum, m_channelLevels);
+        juce::FloatVectorOperations::max(m_levels.data(), m_levels.data(), m_channelLevels.data(), numRows);
+    }
+
+    // low frequencies at the bottom
+    juce::Image::BitmapData column(m_history, m_writeColumn, 0, 1, numRows, juce::Image::BitmapData::writeOnly);
+
+    for (int row = 0; row < numRows; ++row) {
+        const float level = m_levels[static_cast<size_t>(numRows - 1 - row)];
+        const int colourIndex = juce::jlimit(0, COLOUR_MAP_SIZE - 1, static_cast<int>(level * (COLOUR_MAP_SIZE - 1)));
+
+        *reinterpret_cast<juce::PixelARGB*>(column.getPixelPointer(0, row)) = m_colourMap[static_cast<size_t>(colourIndex)];
+    }
+
+    m_writeColumn = (m_writeColumn + 1) % m_historyDepth;
+    this->repaint();
+}
+
+void SpectrogramView::paint(juce::Graphics& g)
+{
+    const int width = this->getWidth();
+    const int height = this->getHeight();
+    const int numRows = m_history.getHeight();
+
+    // the columns from the write position on are the oldest and go on the left
+    const int numOldColumns = m_historyDepth - m_writeColumn;
+    const int splitX = juce::roundToInt(static_cast<float>(width) * static_cast<float>(numOldColumns) / static_cast<float>(m_historyDepth));
+
+    g.drawImage(m_history, 0, 0, splitX, height, m_writeColumn, 0, numOldColumns, numRows);
+
+    if (m_writeColumn > 0) {
+        g.drawImage(m_history, splitX, 0, width - splitX, height, 0, 0, m_writeColumn, numRows);
+    }
+}
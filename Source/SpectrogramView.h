@@ -0,0 +1,44 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "SpectrumRenderer.h"
+
+// scrolling spectrogram: every frame is turned into one pixel column of a ring-addressed image, which is drawn in two
+// pieces split at the write position, so the cost of a frame does not depend on how much history is on screen
+class SpectrogramView : public juce::Component
+{
+  public:
+    SpectrogramView();
+
+    // the number of frames across the width of the view; clears the history
+    void setHistoryDepth(int numFrames);
+    int getHistoryDepth() const;
+
+    // adds the loudest of the channels' spectra as the newest column
+    void pushFrame(const std::vector<std::vector<float>>& spectra, double sampleRate);
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+  private:
+    enum
+    {
+        COLOUR_MAP_SIZE = 256,
+    };
+
+    int m_historyDepth = 240;
+
+    // one column per frame and one row per pixel; m_writeColumn is the oldest column, about to be overwritten
+    juce::Image m_history;
+    int m_writeColumn = 0;
+
+    // rows are the renderer's columns, laid out along the height of the view
+    SpectrumRenderer m_renderer;
+    std::vector<float> m_levels;
+    std::vector<float> m_channelLevels;
+
+    std::array<juce::PixelARGB, COLOUR_MAP_SIZE> m_colourMap;
+
+    void resetHistory();
+};
@@ -0,0 +1,127 @@
+#include "SpectrumRenderer.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr float MIN_FREQUENCY = 20.f;
+    constexpr float MIN_LEVEL_DB = 0.f;
+    constexpr float MAX_LEVEL_DB = 80.f;
+
+    constexpr float EPSILON = std::numeric_limits<float>::epsilon();
+
+    float getLevel(float amplitude)
+    {
+        const float levelInDb = 10.f * std::log(amplitude + EPSILON);
+        return juce::jlimit(0.f, MAX_LEVEL_DB - MIN_LEVEL_DB, levelInDb - MIN_LEVEL_DB) / (MAX_LEVEL_DB - MIN_LEVEL_DB);
+    }
+}
+
+void SpectrumRenderer::setAggregation(Aggregation aggregation)
+{
+    m_aggregation = aggregation;
+}
+
+void SpectrumRenderer::prepare(juce::Rectangle<int> bounds, double sampleRate, int numBins)
+{
+    if (bounds == m_bounds && sampleRate == m_sampleRate && numBins == m_numBins) {
+        return;
+    }
+
+    m_bounds = bounds;
+    m_sampleRate = sampleRate;
+    m_numBins = numBins;
+
+    const int numColumns = juce::jmax(0, bounds.getWidth());
+    m_columnFirstBins.resize(static_cast<size_t>(numColumns));
+    m_columnEndBins.resize(static_cast<size_t>(numColumns));
+    m_binSums.resize(static_cast<size_t>(juce::jmax(0, numBins)) + 1);
+
+    if (numBins < 2) {
+        std::fill(m_columnFirstBins.begin(), m_columnFirstBins.end(), 0);
+        std::fill(m_columnEndBins.begin(), m_columnEndBins.end(), juce::jmax(0, numBins));
+        return;
+    }
+
+    // before the host reports a rate the axis is laid out for a typical one
+    const double nyquist = (sampleRate > 0.0 ? sampleRate : 44100.0) / 2.0;
+    const double binWidth = nyquist / static_cast<double>(numBins - 1);
+    const double logRange = std::log10(nyquist - MIN_FREQUENCY);
+
+    // x = log10(f - MIN_FREQUENCY) / log10(nyquist - MIN_FREQUENCY), inverted at the column edges
+    auto getFrequency = [&](double x) { return MIN_FREQUENCY + std::pow(10.0, x * logRange); };
+
+    for (int column = 0; column < numColumns; ++column) {
+        const double x = static_cast<double>(column) / numColumns;
+        const double nextX = static_cast<double>(column + 1) / numColumns;
+
+        int firstBin = juce::jlimit(1, numBins, static_cast<int>(std::ceil(getFrequency(x) / binWidth)));
+        int endBin = juce::jlimit(1, numBins, static_cast<int>(std::ceil(getFrequency(nextX) / binWidth)));
+
+        // low columns are narrower than a bin, so they show the bin nearest their centre
+        if (firstBin >= endBin) {
+            firstBin = juce::jlimit(1, numBins - 1, static_cast<int>(std::lround(getFrequency((x + nextX) / 2.0) / binWidth)));
+            endBin = firstBin + 1;
+        }
+
+        m_columnFirstBins[static_cast<size_t>(column)] = firstBin;
+        m_columnEndBins[static_cast<size_t>(column)] = endBin;
+    }
+}
+
+int SpectrumRenderer::getNumColumns() const
+{
+    return static_cast<int>(m_columnFirstBins.size());
+}
+
+void SpectrumRenderer::computeLevels(const std::vector<float>& spectrum, std::vector<float>& levels)
+{
+    const size_t numColumns = m_columnFirstBins.size();
+    levels.resize(numColumns);
+
+    if (static_cast<int>(spectrum.size()) < m_numBins || m_numBins < 2) {
+        std::fill(levels.begin(), levels.end(), 0.f);
+        return;
+    }
+
+    if (m_aggregation == Aggregation::mean) {
+        m_binSums[0] = 0.0;
+
+        for (int bin = 0; bin < m_numBins; ++bin) {
+            m_binSums[static_cast<size_t>(bin) + 1] = m_binSums[static_cast<size_t>(bin)] + spectrum[static_cast<size_t>(bin)];
+        }
+    }
+
+    for (size_t column = 0; column < numColumns; ++column) {
+        const int firstBin = m_columnFirstBins[column];
+        const int endBin = m_columnEndBins[column];
+        float amplitude;
+
+        if (m_aggregation == Aggregation::mean) {
+            amplitude = static_cast<float>((m_binSums[static_cast<size_t>(endBin)] - m_binSums[static_cast<size_t>(firstBin)]) / (endBin - firstBin));
+        } else {
+            amplitude = juce::FloatVectorOperations::findMaximum(spectrum.data() + firstBin, endBin - firstBin);
+        }
+
+        // the level curve is monotonic, so one logarithm per column is enough
+        levels[column] = getLevel(amplitude);
+    }
+}
+
+void SpectrumRenderer::createPath(const std::vector<float>& levels, juce::Path& path) const
+{
+    const float left = static_cast<float>(m_bounds.getX());
+    const float bottom = static_cast<float>(m_bounds.getBottom());
+    const float height = static_cast<float>(m_bounds.getHeight());
+    const size_t numColumns = juce::jmin(levels.size(), m_columnFirstBins.size());
+
+    path.clear();
+    path.startNewSubPath(left, bottom);
+
+    for (size_t column = 0; column < numColumns; ++column) {
+        path.lineTo(left + static_cast<float>(column) + 0.5f, bottom - height * levels[column]);
+    }
+
+    path.lineTo(static_cast<float>(m_bounds.getRight()), bottom);
+    path.closeSubPath();
+}
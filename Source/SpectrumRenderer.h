@@ -0,0 +1,44 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// draws a spectrum at the resolution of the screen rather than of the FFT: bins are mapped to pixel columns on a
+// log-frequency axis once per geometry change, and each frame is reduced to one level per column
+class SpectrumRenderer
+{
+  public:
+    enum class Aggregation
+    {
+        // loudest bin in the column, so narrow peaks survive at high frequencies
+        peak,
+        // mean magnitude of the column's bins
+        mean,
+    };
+
+    void setAggregation(Aggregation aggregation);
+
+    // rebuilds the bin to column mapping if any of these changed since the last call
+    void prepare(juce::Rectangle<int> bounds, double sampleRate, int numBins);
+
+    int getNumColumns() const;
+
+    // reduces a frame of magnitudes to levels in [0, 1], one per column
+    void computeLevels(const std::vector<float>& spectrum, std::vector<float>& levels);
+
+    // one vertex per column, closed along the bottom edge of the bounds
+    void createPath(const std::vector<float>& levels, juce::Path& path) const;
+
+  private:
+    Aggregation m_aggregation = Aggregation::peak;
+
+    juce::Rectangle<int> m_bounds;
+    double m_sampleRate = 0.0;
+    int m_numBins = 0;
+
+    // every column covers the bins [m_columnFirstBins[c], m_columnEndBins[c]), which is never empty
+    std::vector<int> m_columnFirstBins;
+    std::vector<int> m_columnEndBins;
+
+    // running sums of the current frame, so a column's mean costs two lookups however many bins it spans
+    std::vector<double> m_binSums;
+};
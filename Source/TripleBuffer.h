@@ -0,0 +1,45 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// wait-free single-producer, single-consumer hand-off of whole frames: the producer fills its private slot and
+// swaps it with the shared middle one, and the consumer swaps the middle slot with its own when a new frame is there.
+// neither side ever waits, and the consumer always holds the latest complete frame
+template<typename FrameType>
+class TripleBuffer
+{
+  public:
+    TripleBuffer();
+    TripleBuffer(const FrameType& initialFrame);
+
+    // producer side
+    FrameType& getWriteFrame();
+    void publish();
+
+    // consumer side; returns true if a frame newer than the one held was latched
+    bool update();
+    const FrameType& getReadFrame() const;
+    uint64_t getReadFrameNumber() const;
+
+  private:
+    enum
+    {
+        INDEX_MASK = 3,
+        NEW_FRAME_FLAG = 4,
+    };
+
+    std::array<FrameType, 3> m_frames;
+    std::array<uint64_t, 3> m_frameNumbers = {};
+
+    std::atomic<int> m_middleIndex = 1;
+    int m_writeIndex = 0;
+    int m_readIndex = 2;
+    uint64_t m_numPublished = 0;
+};
+
+#include "TripleBuffer.tcc"
+
+#endif
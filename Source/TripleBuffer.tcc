@@ -0,0 +1,48 @@
+template<typename FrameType>
+TripleBuffer<FrameType>::TripleBuffer()
+{
+}
+
+template<typename FrameType>
+TripleBuffer<FrameType>::TripleBuffer(const FrameType& initialFrame)
+  : m_frames{ initialFrame, initialFrame, initialFrame }
+{
+}
+
+template<typename FrameType>
+FrameType& TripleBuffer<FrameType>::getWriteFrame()
+{
+    return m_frames[m_writeIndex];
+}
+
+template<typename FrameType>
+void TripleBuffer<FrameType>::publish()
+{
+    m_frameNumbers[m_writeIndex] = ++m_numPublished;
+
+    // release makes the frame visible before its index; acquire hands back a slot the consumer has let go of
+    m_writeIndex = m_middleIndex.exchange(m_writeIndex | NEW_FRAME_FLAG, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+template<typename FrameType>
+bool TripleBuffer<FrameType>::update()
+{
+    if ((m_middleIndex.load(std::memory_order_relaxed) & NEW_FRAME_FLAG) == 0) {
+        return false;
+    }
+
+    m_readIndex = m_middleIndex.exchange(m_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+}
+
+template<typename FrameType>
+const FrameType& TripleBuffer<FrameType>::getReadFrame() const
+{
+    return m_frames[m_readIndex];
+}
+
+template<typename FrameType>
+uint64_t TripleBuffer<FrameType>::getReadFrameNumber() const
+{
+    return m_frameNumbers[m_readIndex];
+}
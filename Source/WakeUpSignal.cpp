@@ -0,0 +1,39 @@
+#include "WakeUpSignal.h"
+
+#if JUCE_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+void WakeUpSignal::reset()
+{
+    m_state.store(awake);
+}
+
+void WakeUpSignal::signal()
+{
+    if (m_state.exchange(signalled) == asleep) {
+#if JUCE_LINUX
+        syscall(SYS_futex, &m_state, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        m_event.signal();
+#endif
+    }
+}
+
+void WakeUpSignal::wait(int timeoutMs)
+{
+    int expected = awake;
+
+    if (!m_state.compare_exchange_strong(expected, asleep)) {
+        return;
+    }
+
+#if JUCE_LINUX
+    const timespec timeout{ timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+    syscall(SYS_futex, &m_state, FUTEX_WAIT_PRIVATE, asleep, &timeout, nullptr, 0);
+#else
+    m_event.wait(timeoutMs);
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// wakes one sleeping thread without taking a lock: signal() only flips an atomic, and makes a system call only when the
+// thread is actually asleep, so an audio thread may send it. on Linux the thread sleeps on the atomic itself as a
+// futex; elsewhere it falls back to an event, whose signal does take a lock, but only while the thread sleeps
+//
+// the sleeping thread calls reset() before each pass over its work and wait() after it; a signal sent since the reset
+// makes the wait return straight away, so work published during the pass is never slept through
+class WakeUpSignal
+{
+  public:
+    void reset();
+    void signal();
+
+    // returns early if signalled, or straight away if a signal arrived since the last reset()
+    void wait(int timeoutMs);
+
+  private:
+    enum State
+    {
+        awake,
+        signalled,
+        asleep,
+    };
+
+    std::atomic<int> m_state = awake;
+
+#if !JUCE_LINUX
+    juce::WaitableEvent m_event;
+#endif
+};
@@ -0,0 +1,95 @@
+#include <JuceHeader.h>
+
+#include "../../BatchRenderer/Source/BatchRenderer.h"
+#include "../../Source/PluginProcessor.h"
+
+// renders a synthetic file in segments with verification on, which renders it again in one piece and compares the two
+// bit for bit, at every overlap and at block sizes that do and do not divide the hop
+class BatchRendererTests : public juce::UnitTest
+{
+  public:
+    BatchRendererTests()
+      : juce::UnitTest("BatchRenderer", "FourierFilter")
+    {
+    }
+
+    void runTest() override
+    {
+        const juce::TemporaryFile input(".wav");
+
+        this->beginTest("synthetic input");
+        this->expect(this->writeInput(input.getFile()), "cannot write " + input.getFile().getFullPathName());
+
+        for (const juce::String overlap : { "2x", "4x", "8x" }) {
+            for (const int blockSize : { 64, 441, 512 }) {
+                this->beginTest("segmented matches serial at " + overlap + " overlap, " + juce::String(blockSize) + " sample blocks");
+                this->expectSegmentedMatchesSerial(input.getFile(), overlap, blockSize);
+            }
+        }
+    }
+
+  private:
+    static constexpr int numSegments = 3;
+    static constexpr int numChannels = 2;
+    static constexpr double sampleRate = 48000.0;
+
+    // segments are at least 32 of the largest FFTs long; the remainder leaves the last one ending off the hop grid
+    static int getNumSamples() { return numSegments * 32 * (1 << MAX_FFT_ORDER) + 1234; }
+
+    // noise under a slow tremolo, different on each channel, written as floats so that the input itself is exact
+    bool writeInput(const juce::File& file)
+    {
+        std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+
+        if (stream == nullptr || stream->failedToOpen()) {
+            return false;
+        }
+
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), sampleRate, numChannels, 32, {}, 0));
+
+        if (writer == nullptr) {
+            return false;
+        }
+
+        // the writer owns the stream from here on
+        stream.release();
+
+        const int numSamples = getNumSamples();
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        auto random = this->getRandom();
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            float* samples = buffer.getWritePointer(channel);
+
+            for (int i = 0; i < numSamples; ++i) {
+                const double tremolo = 0.5 + 0.5 * std::sin(juce::MathConstants<double>::twoPi * (channel + 1) * i / sampleRate);
+                samples[i] = static_cast<float>(tremolo) * (random.nextFloat() * 2.f - 1.f);
+            }
+        }
+
+        return writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+    }
+
+    void expectSegmentedMatchesSerial(const juce::File& input, const juce::String& overlap, int blockSize)
+    {
+        BatchRenderer::Settings settings;
+        settings.parameters.set("overlap", overlap);
+        settings.numThreads = numSegments;
+        settings.blockSize = blockSize;
+        settings.numSegments = numSegments;
+        settings.verify = true;
+
+        BatchRenderer renderer(std::move(settings));
+        const auto results = renderer.render(juce::Array<juce::File>{ input });
+        const auto& result = results.front();
+
+        result.output.deleteFile();
+
+        this->expect(result.error.isEmpty(), result.error);
+        this->expectEquals(result.numSegments, numSegments, "the file was not split");
+        this->expect(result.isVerified, "the segmented render was not verified");
+    }
+};
+
+static BatchRendererTests batchRendererTests;
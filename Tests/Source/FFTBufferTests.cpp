@@ -0,0 +1,191 @@
+#include <JuceHeader.h>
+
+#include "../../Source/FFTBuffer.h"
+
+// a stereo buffer, whose engine packs both channels into one complex transform, against two mono buffers running the
+// same processor on real transforms; also with the stereo buffer switched to per-channel calls part way through, and
+// handing its channels to a worker pool, both of which unpack it mid-stream
+class FFTBufferTests : public juce::UnitTest
+{
+  public:
+    FFTBufferTests()
+      : juce::UnitTest("FFTBuffer", "FourierFilter")
+    {
+    }
+
+    void runTest() override
+    {
+        const auto input = this->createInput();
+        RealtimeWorkerPool workerPool(2);
+
+        for (const unsigned numOverlaps : { 2u, 8u }) {
+            for (const auto scheduling : { FFTBuffer::Scheduling::immediate,
+                                           FFTBuffer::Scheduling::worker,
+                                           FFTBuffer::Scheduling::amortized,
+                                           FFTBuffer::Scheduling::batched }) {
+                const juce::String context = juce::String(static_cast<int>(numOverlaps)) + "x overlap, " + getSchedulingName(scheduling) + " scheduling";
+
+                this->beginTest("stereo matches two mono buffers at " + context);
+                this->expectStereoMatchesMono(input, numOverlaps, scheduling, false);
+
+                this->beginTest("stereo driven per channel part way matches two mono buffers at " + context);
+                this->expectStereoMatchesMono(input, numOverlaps, scheduling, true);
+
+                this->beginTest("stereo on a worker pool matches two mono buffers at " + context);
+                this->expectStereoMatchesMono(input, numOverlaps, scheduling, false, &workerPool);
+            }
+        }
+    }
+
+  private:
+    static constexpr unsigned fftOrder = FFTBuffer::minFFTOrder;
+    static constexpr int numChannels = 2;
+    static constexpr int numSamples = 6000;
+
+    // packing rounds differently from two real transforms, so the outputs only agree to within this
+    static constexpr float tolerance = 1.0e-4f;
+
+    // a different gain slope and phase rotation on each channel, so that crossed channels and misplaced bins both show;
+    // dc and nyquist are only scaled, since they are real in the spectrum of any real signal
+    struct Processor
+    {
+        unsigned channelOffset;
+
+        void operator()(std::complex<float>* bins, unsigned channel) const
+        {
+            constexpr unsigned nyquistBin = (1u << fftOrder) / 2;
+            const unsigned sourceChannel = channel + channelOffset;
+            const float slope = sourceChannel == 0 ? -0.5f : 0.75f;
+
+            for (unsigned bin = 0; bin <= nyquistBin; ++bin) {
+                const float position = static_cast<float>(bin) / nyquistBin;
+                const float phase = bin == 0 || bin == nyquistBin ? 0.f : static_cast<float>(sourceChannel + 1) * 2.f * position;
+
+                bins[bin] *= std::polar(1.f + slope * position, phase);
+            }
+        }
+    };
+
+    enum class Driver
+    {
+        multiChannel,
+        perChannel,
+        perSample,
+    };
+
+    static juce::String getSchedulingName(FFTBuffer::Scheduling scheduling)
+    {
+        switch (scheduling) {
+            case FFTBuffer::Scheduling::immediate:
+                return "immediate";
+            case FFTBuffer::Scheduling::worker:
+                return "worker";
+            case FFTBuffer::Scheduling::amortized:
+                return "amortized";
+            case FFTBuffer::Scheduling::batched:
+                return "batched";
+        }
+
+        return {};
+    }
+
+    juce::AudioBuffer<float> createInput()
+    {
+        juce::AudioBuffer<float> input(numChannels, numSamples);
+        auto random = this->getRandom();
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            for (int i = 0; i < numSamples; ++i) {
+                input.setSample(channel, i, random.nextFloat() * 2.f - 1.f);
+            }
+        }
+
+        return input;
+    }
+
+    static std::unique_ptr<FFTBuffer> createBuffer(unsigned numBufferChannels, unsigned numOverlaps, FFTBuffer::Scheduling scheduling, unsigned channelOffset)
+    {
+        auto buffer = std::make_unique<FFTBuffer>(numBufferChannels, fftOrder, numOverlaps, Processor{ channelOffset });
+        buffer->prepareScheduling(scheduling);
+        buffer->setScheduling(scheduling);
+        return buffer;
+    }
+
+    // the stereo buffer and the mono pair go through the same calls with the same block sizes
+    void expectStereoMatchesMono(const juce::AudioBuffer<float>& input,
+                                 unsigned numOverlaps,
+                                 FFTBuffer::Scheduling scheduling,
+                                 bool isSwitched,
+                                 RealtimeWorkerPool* workerPool = nullptr)
+    {
+        auto stereo = createBuffer(numChannels, numOverlaps, scheduling, 0);
+        stereo->setWorkerPool(workerPool);
+        auto left = createBuffer(1, numOverlaps, scheduling, 0);
+        auto right = createBuffer(1, numOverlaps, scheduling, 1);
+
+        juce::AudioBuffer<float> stereoOutput(numChannels, numSamples);
+        juce::AudioBuffer<float> monoOutput(numChannels, numSamples);
+        auto random = this->getRandom();
+
+        for (int offset = 0; offset < numSamples;) {
+            const int numBlock = juce::jmin(numSamples - offset, 1 + random.nextInt(700));
+            const Driver driver = !isSwitched || offset < numSamples / 3 ? Driver::multiChannel
+                                  : offset < 2 * numSamples / 3         ? Driver::perChannel
+                                                                        : Driver::perSample;
+
+            const float* const stereoIn[] = { input.getReadPointer(0, offset), input.getReadPointer(1, offset) };
+            float* const stereoOut[] = { stereoOutput.getWritePointer(0, offset), stereoOutput.getWritePointer(1, offset) };
+            processBlock(*stereo, stereoIn, stereoOut, numBlock, driver);
+
+            const float* const leftIn[] = { input.getReadPointer(0, offset) };
+            float* const leftOut[] = { monoOutput.getWritePointer(0, offset) };
+            processBlock(*left, leftIn, leftOut, numBlock, driver);
+
+            const float* const rightIn[] = { input.getReadPointer(1, offset) };
+            float* const rightOut[] = { monoOutput.getWritePointer(1, offset) };
+            processBlock(*right, rightIn, rightOut, numBlock, driver);
+
+            offset += numBlock;
+        }
+
+        float maxError = 0.f;
+        float maxOutput = 0.f;
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            for (int i = 0; i < numSamples; ++i) {
+                maxError = juce::jmax(maxError, std::abs(stereoOutput.getSample(channel, i) - monoOutput.getSample(channel, i)));
+                maxOutput = juce::jmax(maxOutput, std::abs(monoOutput.getSample(channel, i)));
+            }
+        }
+
+        this->expect(maxOutput > 0.1f, "the buffers produced no output");
+        this->expect(maxError < tolerance, "outputs differ by up to " + juce::String(maxError));
+    }
+
+    // per sample, each result is read before the sample that follows it is written, as process() does
+    static void processBlock(FFTBuffer& buffer, const float* const* input, float* const* output, int numBlock, Driver driver)
+    {
+        const unsigned numBufferChannels = buffer.getNumChannels();
+
+        switch (driver) {
+            case Driver::multiChannel:
+                buffer.process(input, output, numBlock);
+                break;
+            case Driver::perChannel:
+                for (unsigned channel = 0; channel < numBufferChannels; ++channel) {
+                    buffer.process(input[channel], output[channel], numBlock, channel);
+                }
+                break;
+            case Driver::perSample:
+                for (int i = 0; i < numBlock; ++i) {
+                    for (unsigned channel = 0; channel < numBufferChannels; ++channel) {
+                        output[channel][i] = buffer.readResult(channel);
+                        buffer.write(channel, input[channel][i]);
+                    }
+                }
+                break;
+        }
+    }
+};
+
+static FFTBufferTests fftBufferTests;
@@ -0,0 +1,20 @@
+#include <JuceHeader.h>
+
+// runs every test in the FourierFilter category and exits non-zero if any of them failed
+int main()
+{
+    // the processor's parameters expect a message manager, even though no message loop ever runs
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTestsInCategory("FourierFilter");
+
+    int numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i) {
+        numFailures += runner.getResult(i)->failures;
+    }
+
+    return numFailures == 0 ? 0 : 1;
+}
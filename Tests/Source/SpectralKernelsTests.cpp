@@ -0,0 +1,92 @@
+#include <JuceHeader.h>
+
+#include "../../Source/SpectralKernels.h"
+
+// every vectorized implementation the CPU supports, checked bit for bit against the scalar reference over random input,
+// at lengths that leave every possible tail and from addresses that are not vector-aligned
+class SpectralKernelsTests : public juce::UnitTest
+{
+  public:
+    SpectralKernelsTests()
+      : juce::UnitTest("SpectralKernels", "FourierFilter")
+    {
+    }
+
+    void runTest() override
+    {
+        using SpectralKernels::Implementation;
+
+        const auto originalImplementation = SpectralKernels::getImplementation();
+
+        for (const auto implementation : { Implementation::sse2, Implementation::avx2, Implementation::neon }) {
+            if (!SpectralKernels::isAvailable(implementation)) {
+                continue;
+            }
+
+            this->beginTest(juce::String(SpectralKernels::getName(implementation)) + " matches scalar");
+
+            for (const int numSamples : { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 23, 31, 32, 33, 63, 65, 127, 1000, 1025 }) {
+                // a float's offset misaligns every vector width
+                for (const int offset : { 0, 1, 3 }) {
+                    this->checkKernels(implementation, numSamples, offset);
+                }
+            }
+        }
+
+        SpectralKernels::setImplementation(originalImplementation);
+    }
+
+  private:
+    // three operand regions, each large enough for numSamples complex values plus a guard past the end
+    static int getRegionSize(int numSamples) { return 2 * numSamples + 32; }
+
+    void checkKernels(SpectralKernels::Implementation implementation, int numSamples, int offset)
+    {
+        const int regionSize = getRegionSize(numSamples);
+        const juce::String context = " at length " + juce::String(numSamples) + ", offset " + juce::String(offset);
+
+        auto operand = [regionSize, offset](float* memory, int index) { return memory + index * regionSize + offset; };
+        auto bins = [&operand](float* memory, int index) { return reinterpret_cast<std::complex<float>*>(operand(memory, index)); };
+
+        this->expectMatchesScalar(implementation, numSamples, "multiply" + context, [&](float* memory) {
+            SpectralKernels::multiply(operand(memory, 0), operand(memory, 1), operand(memory, 2), numSamples);
+        });
+        this->expectMatchesScalar(
+            implementation, numSamples, "add" + context, [&](float* memory) { SpectralKernels::add(operand(memory, 0), operand(memory, 1), numSamples); });
+        this->expectMatchesScalar(implementation, numSamples, "multiplyBins" + context, [&](float* memory) {
+            SpectralKernels::multiplyBins(bins(memory, 0), operand(memory, 1), numSamples);
+        });
+        this->expectMatchesScalar(implementation, numSamples, "binPowers" + context, [&](float* memory) {
+            SpectralKernels::binPowers(operand(memory, 0), bins(memory, 1), numSamples);
+        });
+        this->expectMatchesScalar(implementation, numSamples, "binMagnitudes" + context, [&](float* memory) {
+            SpectralKernels::binMagnitudes(operand(memory, 0), bins(memory, 1), numSamples);
+        });
+    }
+
+    // runs the kernel over identical random memory once with the scalar reference and once with the implementation, and
+    // expects the same bits everywhere afterwards, which also catches a write past the end that only one of them makes
+    template<typename Kernel>
+    void expectMatchesScalar(SpectralKernels::Implementation implementation, int numSamples, const juce::String& name, Kernel kernel)
+    {
+        std::vector<float> expected(static_cast<size_t>(3 * getRegionSize(numSamples)));
+        auto random = this->getRandom();
+
+        // spread over several orders of magnitude, so that rounding differences would show
+        for (auto& value : expected) {
+            value = (random.nextFloat() * 2.f - 1.f) * std::pow(10.f, static_cast<float>(random.nextInt(7) - 3));
+        }
+
+        auto actual = expected;
+
+        SpectralKernels::setImplementation(SpectralKernels::Implementation::scalar);
+        kernel(expected.data());
+
+        SpectralKernels::setImplementation(implementation);
+        kernel(actual.data());
+
+        this->expect(std::memcmp(expected.data(), actual.data(), expected.size() * sizeof(float)) == 0, name);
+    }
+};
+
+static SpectralKernelsTests spectralKernelsTests;